@@ -0,0 +1,164 @@
+#include "async_search_server.h"
+
+#include <algorithm>
+
+using namespace std::string_literals;
+
+struct AsyncSearchServer::Worker {
+    SearchServer::Scratch scratch;
+    std::vector<Document> documents;
+};
+
+QueryCancellation::QueryCancellation() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+void QueryCancellation::Cancel() {
+    *cancelled_ = true;
+}
+
+bool QueryCancellation::IsCancelled() const {
+    return *cancelled_;
+}
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, const AsyncSearchOptions& options)
+        : search_server_(search_server), max_queue_depth_(options.max_queue_depth) {
+    const size_t thread_count = options.thread_count > 0 ? options.thread_count
+                                                         : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this] {
+            Run();
+        });
+    }
+}
+
+AsyncSearchServer::~AsyncSearchServer() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    task_added_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentStatus status,
+                                                                            const QueryCancellation* cancellation) {
+    auto promise = std::make_shared<std::promise<std::vector<Document>>>();
+    auto future = promise->get_future();
+    FindTopDocumentsAsync(std::move(raw_query), status, [promise](std::vector<Document> documents, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(std::move(documents));
+        }
+    }, cancellation);
+    return future;
+}
+
+void AsyncSearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentStatus status, FindCallback callback,
+                                              const QueryCancellation* cancellation) {
+    Submit([this, raw_query = std::move(raw_query), status, callback = std::move(callback)](Worker* worker, std::exception_ptr error) {
+        if (error) {
+            callback({}, error);
+            return;
+        }
+        std::vector<Document> documents;
+        try {
+            worker->documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            const size_t count = search_server_.FindTopDocuments(worker->scratch, raw_query, status, MAX_RESULT_DOCUMENT_COUNT,
+                                                                 worker->documents.data());
+            documents.assign(worker->documents.begin(), worker->documents.begin() + count);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        callback(std::move(documents), error);
+    }, cancellation);
+}
+
+std::future<AsyncSearchServer::MatchResult> AsyncSearchServer::MatchDocumentAsync(std::string raw_query, int document_id,
+                                                                                  const QueryCancellation* cancellation) {
+    auto promise = std::make_shared<std::promise<MatchResult>>();
+    auto future = promise->get_future();
+    MatchDocumentAsync(std::move(raw_query), document_id, [promise](MatchResult result, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(std::move(result));
+        }
+    }, cancellation);
+    return future;
+}
+
+void AsyncSearchServer::MatchDocumentAsync(std::string raw_query, int document_id, MatchCallback callback,
+                                           const QueryCancellation* cancellation) {
+    Submit([this, raw_query = std::move(raw_query), document_id, callback = std::move(callback)](Worker*, std::exception_ptr error) {
+        if (error) {
+            callback({}, error);
+            return;
+        }
+        MatchResult result;
+        try {
+            result = search_server_.MatchDocument(raw_query, document_id);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        callback(std::move(result), error);
+    }, cancellation);
+}
+
+size_t AsyncSearchServer::GetQueueDepth() const {
+    std::lock_guard guard(mutex_);
+    return tasks_.size();
+}
+
+AsyncSearchStats AsyncSearchServer::GetStats() const {
+    return {accepted_.load(), rejected_.load(), cancelled_.load(), completed_.load(), callback_errors_.load()};
+}
+
+void AsyncSearchServer::Submit(Task task, const QueryCancellation* cancellation) {
+    {
+        std::lock_guard guard(mutex_);
+        if (!is_stopping_ && tasks_.size() < max_queue_depth_) {
+            tasks_.emplace_back(std::move(task), cancellation != nullptr ? *cancellation : QueryCancellation());
+            ++accepted_;
+            task_added_.notify_one();
+            return;
+        }
+    }
+    ++rejected_;
+    RunTask(task, nullptr, std::make_exception_ptr(QueryRejectedError("Query queue is full"s)));
+}
+
+void AsyncSearchServer::RunTask(const Task& task, Worker* worker, std::exception_ptr error) {
+    try {
+        task(worker, error);
+    } catch (...) {
+        ++callback_errors_;
+    }
+}
+
+void AsyncSearchServer::Run() {
+    Worker worker;
+    while (true) {
+        std::pair<Task, QueryCancellation> task;
+        {
+            std::unique_lock lock(mutex_);
+            task_added_.wait(lock, [this] {
+                return is_stopping_ || !tasks_.empty();
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        if (task.second.IsCancelled()) {
+            ++cancelled_;
+            RunTask(task.first, &worker, std::make_exception_ptr(QueryCancelledError("Query was cancelled"s)));
+        } else {
+            // Запрос засчитывается до вызова обработчика, чтобы результат не опережал статистику
+            ++completed_;
+            RunTask(task.first, &worker, nullptr);
+        }
+    }
+}
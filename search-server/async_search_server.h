@@ -0,0 +1,143 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Запрос не принят: очередь заполнена или сервер останавливается
+class QueryRejectedError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Запрос отменён до начала выполнения
+class QueryCancelledError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Флаг отмены, разделяемый между вызывающим и очередью. Отмена действует на запросы,
+// которые ещё не начали выполняться; начатый поиск доводится до конца
+class QueryCancellation {
+public:
+    QueryCancellation();
+
+    void Cancel();
+
+    bool IsCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+struct AsyncSearchOptions {
+    // 0 — по числу аппаратных потоков
+    size_t thread_count = 0;
+
+    // Запросы сверх этого числа ожидающих выполнения отклоняются сразу
+    size_t max_queue_depth = 1024;
+};
+
+struct AsyncSearchStats {
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t cancelled = 0;
+    uint64_t completed = 0;
+
+    // Исключения, выброшенные обработчиками завершения; они перехватываются и отбрасываются
+    uint64_t callback_errors = 0;
+};
+
+// Асинхронные FindTopDocuments и MatchDocument на собственном ограниченном пуле потоков.
+// Результат доставляется через std::future или обработчик завершения; при отказе
+// или отмене — исключением QueryRejectedError или QueryCancelledError.
+// Обработчики не должны выбрасывать исключения: выброшенное исключение отбрасывается
+// и учитывается в AsyncSearchStats::callback_errors.
+// Изменять SearchServer, пока есть незавершённые запросы, нельзя
+class AsyncSearchServer {
+public:
+    using FindCallback = std::function<void(std::vector<Document> documents, std::exception_ptr error)>;
+
+    using MatchResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+    using MatchCallback = std::function<void(MatchResult result, std::exception_ptr error)>;
+
+    explicit AsyncSearchServer(const SearchServer& search_server, const AsyncSearchOptions& options = {});
+
+    AsyncSearchServer(const AsyncSearchServer&) = delete;
+
+    AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+    // Дожидается выполнения уже принятых запросов
+    ~AsyncSearchServer();
+
+    std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query,
+                                                             DocumentStatus status = DocumentStatus::ACTUAL,
+                                                             const QueryCancellation* cancellation = nullptr);
+
+    // Обработчик вызывается ровно один раз: в потоке пула или, при отказе, в вызывающем потоке
+    void FindTopDocumentsAsync(std::string raw_query, DocumentStatus status, FindCallback callback,
+                               const QueryCancellation* cancellation = nullptr);
+
+    std::future<MatchResult> MatchDocumentAsync(std::string raw_query, int document_id,
+                                                const QueryCancellation* cancellation = nullptr);
+
+    void MatchDocumentAsync(std::string raw_query, int document_id, MatchCallback callback,
+                            const QueryCancellation* cancellation = nullptr);
+
+    size_t GetQueueDepth() const;
+
+    AsyncSearchStats GetStats() const;
+
+private:
+    struct Worker;
+
+    // Задача получает буферы потока пула; error не пуст, если задача отклонена или отменена
+    using Task = std::function<void(Worker* worker, std::exception_ptr error)>;
+
+    const SearchServer& search_server_;
+
+    const size_t max_queue_depth_;
+
+    mutable std::mutex mutex_;
+
+    std::condition_variable task_added_;
+
+    std::deque<std::pair<Task, QueryCancellation>> tasks_;
+
+    bool is_stopping_ = false;
+
+    std::vector<std::thread> threads_;
+
+    std::atomic<uint64_t> accepted_{0};
+
+    std::atomic<uint64_t> rejected_{0};
+
+    std::atomic<uint64_t> cancelled_{0};
+
+    std::atomic<uint64_t> completed_{0};
+
+    std::atomic<uint64_t> callback_errors_{0};
+
+    void Submit(Task task, const QueryCancellation* cancellation);
+
+    // Ошибки поиска задача передаёт обработчику сама, поэтому исключение здесь может прийти только из обработчика
+    void RunTask(const Task& task, Worker* worker, std::exception_ptr error);
+
+    void Run();
+};
@@ -0,0 +1,154 @@
+#include "batch_query_executor.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+BatchQueryExecutor::BatchQueryExecutor(const SearchServer& search_server, const BatchExecutorOptions& options)
+        : search_server_(search_server) {
+    const size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t thread_count = options.thread_count > 0 ? options.thread_count : hardware_threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i] {
+            Run(i);
+        });
+#ifdef __linux__
+        if (options.pin_threads) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(i % hardware_threads, &cpu_set);
+            pthread_setaffinity_np(threads_.back().native_handle(), sizeof(cpu_set), &cpu_set);
+        }
+#endif
+    }
+}
+
+BatchQueryExecutor::~BatchQueryExecutor() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    batch_started_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::vector<std::vector<Document>> BatchQueryExecutor::ProcessQueries(const std::vector<std::string>& queries) {
+    return ProcessQueriesFlat(queries).ToNested();
+}
+
+BatchResults BatchQueryExecutor::ProcessQueriesFlat(const std::vector<std::string>& queries) {
+    BatchResults results(queries.size(), MAX_RESULT_DOCUMENT_COUNT);
+    if (queries.empty()) {
+        return results;
+    }
+    std::lock_guard batch_guard(batch_mutex_);
+    {
+        std::lock_guard guard(mutex_);
+        queries_ = &queries;
+        results_ = &results;
+        pending_count_ = queries.size();
+        first_error_ = nullptr;
+    }
+    // Каждому потоку достаётся непрерывный участок пакета. Состояние пакета записано
+    // до публикации запросов под мьютексами очередей, поэтому поток, ещё не заснувший
+    // после прошлого пакета, может сразу забирать новые запросы
+    for (size_t worker_index = 0; worker_index < workers_.size(); ++worker_index) {
+        Worker& worker = *workers_[worker_index];
+        std::lock_guard guard(worker.mutex);
+        for (size_t query_index = queries.size() * worker_index / workers_.size();
+             query_index < queries.size() * (worker_index + 1) / workers_.size(); ++query_index) {
+            worker.query_indexes.push_back(query_index);
+        }
+    }
+    std::unique_lock lock(mutex_);
+    ++batch_number_;
+    batch_started_.notify_all();
+    batch_finished_.wait(lock, [this] {
+        return pending_count_ == 0;
+    });
+    queries_ = nullptr;
+    results_ = nullptr;
+    if (first_error_) {
+        std::rethrow_exception(first_error_);
+    }
+    results.Seal();
+    return results;
+}
+
+size_t BatchQueryExecutor::GetThreadCount() const {
+    return threads_.size();
+}
+
+void BatchQueryExecutor::Run(size_t worker_index) {
+    Worker& worker = *workers_[worker_index];
+    uint64_t seen_batch_number = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            batch_started_.wait(lock, [&] {
+                return is_stopping_ || batch_number_ != seen_batch_number;
+            });
+            if (is_stopping_) {
+                return;
+            }
+            seen_batch_number = batch_number_;
+        }
+        size_t query_index;
+        size_t processed_count = 0;
+        while (TakeQuery(worker_index, query_index)) {
+            ProcessQuery(worker, query_index);
+            ++processed_count;
+        }
+        if (processed_count > 0) {
+            std::lock_guard guard(mutex_);
+            pending_count_ -= processed_count;
+            if (pending_count_ == 0) {
+                batch_finished_.notify_all();
+            }
+        }
+    }
+}
+
+bool BatchQueryExecutor::TakeQuery(size_t worker_index, size_t& query_index) {
+    {
+        Worker& worker = *workers_[worker_index];
+        std::lock_guard guard(worker.mutex);
+        if (!worker.query_indexes.empty()) {
+            query_index = worker.query_indexes.front();
+            worker.query_indexes.pop_front();
+            return true;
+        }
+    }
+    // Кража с конца очереди: владелец идёт с начала, поэтому блокировки пересекаются редко
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(worker_index + offset) % workers_.size()];
+        std::lock_guard guard(victim.mutex);
+        if (!victim.query_indexes.empty()) {
+            query_index = victim.query_indexes.back();
+            victim.query_indexes.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchQueryExecutor::ProcessQuery(Worker& worker, size_t query_index) {
+    try {
+        results_->SetCount(query_index, search_server_.FindTopDocuments(worker.scratch, (*queries_)[query_index], DocumentStatus::ACTUAL,
+                                                                        MAX_RESULT_DOCUMENT_COUNT, results_->GetSlot(query_index)));
+    } catch (...) {
+        std::lock_guard guard(mutex_);
+        if (!first_error_ || query_index < first_error_index_) {
+            first_error_ = std::current_exception();
+            first_error_index_ = query_index;
+        }
+    }
+}
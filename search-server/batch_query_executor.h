@@ -0,0 +1,88 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+#include "batch_results.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BatchExecutorOptions {
+    // 0 — по числу аппаратных потоков
+    size_t thread_count = 0;
+
+    // Закрепить i-й рабочий поток за процессором i % hardware_concurrency (только Linux)
+    bool pin_threads = false;
+};
+
+// Пул потоков для пакетной обработки запросов. Запросы пакета распределяются
+// по очередям потоков, освободившийся поток забирает запросы из чужих очередей.
+// У каждого потока свой SearchServer::Scratch, переживающий пакеты
+class BatchQueryExecutor {
+public:
+    explicit BatchQueryExecutor(const SearchServer& search_server, const BatchExecutorOptions& options = {});
+
+    BatchQueryExecutor(const BatchQueryExecutor&) = delete;
+
+    BatchQueryExecutor& operator=(const BatchQueryExecutor&) = delete;
+
+    ~BatchQueryExecutor();
+
+    // Результаты поиска документов со статусом ACTUAL в порядке запросов. Если какой-то
+    // запрос некорректен, пакет дорабатывается и выбрасывается исключение первого из них
+    std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries);
+
+    // Результаты записываются потоками сразу в общий буфер, без промежуточных векторов
+    BatchResults ProcessQueriesFlat(const std::vector<std::string>& queries);
+
+    size_t GetThreadCount() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<size_t> query_indexes;
+        SearchServer::Scratch scratch;
+    };
+
+    const SearchServer& search_server_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::vector<std::thread> threads_;
+
+    // Пакеты из разных потоков обрабатываются по очереди
+    std::mutex batch_mutex_;
+
+    std::mutex mutex_;
+
+    std::condition_variable batch_started_;
+
+    std::condition_variable batch_finished_;
+
+    uint64_t batch_number_ = 0;
+
+    size_t pending_count_ = 0;
+
+    bool is_stopping_ = false;
+
+    const std::vector<std::string>* queries_ = nullptr;
+
+    BatchResults* results_ = nullptr;
+
+    size_t first_error_index_ = 0;
+
+    std::exception_ptr first_error_;
+
+    void Run(size_t worker_index);
+
+    bool TakeQuery(size_t worker_index, size_t& query_index);
+
+    void ProcessQuery(Worker& worker, size_t query_index);
+};
@@ -0,0 +1,36 @@
+#include "batch_results.h"
+
+#include <algorithm>
+
+BatchResults::BatchResults(size_t query_count, size_t max_count)
+        : max_count_(max_count), documents_(query_count * max_count), offsets_(query_count + 1, 0) {}
+
+void BatchResults::Seal() {
+    // Результаты сдвигаются только к началу буфера, поэтому копирование по возрастанию безопасно
+    size_t offset = 0;
+    for (size_t query_index = 0; query_index < GetQueryCount(); ++query_index) {
+        const size_t count = offsets_[query_index + 1];
+        const auto slot = documents_.begin() + query_index * max_count_;
+        std::copy(slot, slot + count, documents_.begin() + offset);
+        offset += count;
+        offsets_[query_index + 1] = offset;
+    }
+    documents_.resize(offset);
+}
+
+std::vector<Document> BatchResults::ReleaseDocuments() {
+    std::vector<Document> documents;
+    documents.swap(documents_);
+    std::fill(offsets_.begin(), offsets_.end(), 0);
+    return documents;
+}
+
+std::vector<std::vector<Document>> BatchResults::ToNested() const {
+    std::vector<std::vector<Document>> documents;
+    documents.reserve(GetQueryCount());
+    for (size_t query_index = 0; query_index < GetQueryCount(); ++query_index) {
+        const QueryDocuments query_documents = (*this)[query_index];
+        documents.emplace_back(query_documents.begin(), query_documents.end());
+    }
+    return documents;
+}
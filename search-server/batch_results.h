@@ -0,0 +1,80 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstddef>
+#include <vector>
+
+// Результаты пакета запросов в одном непрерывном буфере. При заполнении каждому
+// запросу отведено max_count мест; после Seal результаты сдвигаются вплотную
+// и доступны по смещениям как по запросам, так и одним сплошным массивом
+class BatchResults {
+public:
+    class QueryDocuments {
+    public:
+        QueryDocuments(const Document* begin, const Document* end) : begin_(begin), end_(end) {}
+
+        const Document* begin() const {
+            return begin_;
+        }
+
+        const Document* end() const {
+            return end_;
+        }
+
+        size_t size() const {
+            return end_ - begin_;
+        }
+
+        bool empty() const {
+            return begin_ == end_;
+        }
+
+        const Document& operator[](size_t index) const {
+            return begin_[index];
+        }
+
+    private:
+        const Document* begin_;
+        const Document* end_;
+    };
+
+    BatchResults(size_t query_count, size_t max_count);
+
+    // Место под результаты запроса query_index; заполняется до вызова Seal,
+    // разные запросы можно заполнять из разных потоков
+    Document* GetSlot(size_t query_index) {
+        return documents_.data() + query_index * max_count_;
+    }
+
+    void SetCount(size_t query_index, size_t count) {
+        offsets_[query_index + 1] = count;
+    }
+
+    void Seal();
+
+    size_t GetQueryCount() const {
+        return offsets_.size() - 1;
+    }
+
+    QueryDocuments operator[](size_t query_index) const {
+        return {documents_.data() + offsets_[query_index], documents_.data() + offsets_[query_index + 1]};
+    }
+
+    const std::vector<Document>& GetDocuments() const {
+        return documents_;
+    }
+
+    // Забирает сплошной буфер без копирования
+    std::vector<Document> ReleaseDocuments();
+
+    std::vector<std::vector<Document>> ToNested() const;
+
+private:
+    size_t max_count_;
+
+    std::vector<Document> documents_;
+
+    // До Seal в offsets_[i + 1] хранится число результатов запроса i
+    std::vector<size_t> offsets_;
+};
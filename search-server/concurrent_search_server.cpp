@@ -0,0 +1,137 @@
+#include "concurrent_search_server.h"
+
+#include <exception>
+#include <thread>
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string& stop_words_text)
+        : ConcurrentSearchServer(std::string_view(stop_words_text)) {}
+
+ConcurrentSearchServer::ConcurrentSearchServer(std::string_view stop_words_text)
+        : servers_{SearchServer(stop_words_text), SearchServer(stop_words_text)} {}
+
+ConcurrentSearchServer::ReadGuard::ReadGuard(const ConcurrentSearchServer& server) : server_(server) {
+    static std::atomic<size_t> next_stripe{0};
+    thread_local const size_t stripe = next_stripe++ % STRIPE_COUNT;
+    while (true) {
+        side_ = server_.active_side_.load();
+        readers_ = &server_.stripes_[stripe].readers[side_];
+        readers_->fetch_add(1);
+        // Если копию успели сменить до регистрации, писатель мог не увидеть этого читателя
+        if (server_.active_side_.load() == side_) {
+            return;
+        }
+        readers_->fetch_sub(1);
+        ++server_.reader_retries_;
+    }
+}
+
+ConcurrentSearchServer::ReadGuard::~ReadGuard() {
+    readers_->fetch_sub(1, std::memory_order_release);
+}
+
+const SearchServer& ConcurrentSearchServer::ReadGuard::GetSearchServer() const {
+    return server_.servers_[side_];
+}
+
+void ConcurrentSearchServer::WaitForReaders(int side) const {
+    for (const ReaderStripe& stripe : stripes_) {
+        while (stripe.readers[side].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ConcurrentSearchServer::Modify(const std::function<void(SearchServer&)>& mutation) {
+    const std::lock_guard lock(writer_mutex_);
+    const int old_side = active_side_.load();
+    const int new_side = 1 - old_side;
+    std::exception_ptr error;
+    try {
+        mutation(servers_[new_side]);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    active_side_.store(new_side);
+    ++published_versions_;
+    WaitForReaders(old_side);
+    try {
+        mutation(servers_[old_side]);
+    } catch (...) {
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                         const std::vector<int>& ratings) {
+    Modify([&](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    Modify([&](SearchServer& search_server) {
+        search_server.AddDocuments(documents);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Modify([&](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    Modify([&](SearchServer& search_server) {
+        search_server.RemoveDocuments(document_ids);
+    });
+}
+
+void ConcurrentSearchServer::UpdateDocumentStatus(int document_id, DocumentStatus status) {
+    Modify([&](SearchServer& search_server) {
+        search_server.UpdateDocumentStatus(document_id, status);
+    });
+}
+
+void ConcurrentSearchServer::UpdateDocumentRating(int document_id, const std::vector<int>& ratings) {
+    Modify([&](SearchServer& search_server) {
+        search_server.UpdateDocumentRating(document_id, ratings);
+    });
+}
+
+void ConcurrentSearchServer::UpdateDocument(int document_id, std::string_view document) {
+    Modify([&](SearchServer& search_server) {
+        search_server.UpdateDocument(document_id, document);
+    });
+}
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                               size_t max_result_count) const {
+    return Read([&](const SearchServer& search_server) {
+        return search_server.FindTopDocuments(raw_query, status, max_result_count);
+    });
+}
+
+ConcurrentSearchServer::MatchResult ConcurrentSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return Read([&](const SearchServer& search_server) {
+        const auto [words, status] = search_server.MatchDocument(raw_query, document_id);
+        return MatchResult(std::vector<std::string>(words.begin(), words.end()), status);
+    });
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& search_server) {
+        return search_server.GetDocumentCount();
+    });
+}
+
+uint64_t ConcurrentSearchServer::GetIndexVersion() const {
+    return Read([](const SearchServer& search_server) {
+        return search_server.GetIndexVersion();
+    });
+}
+
+ConcurrentSearchStats ConcurrentSearchServer::GetStats() const {
+    return {published_versions_.load(), reader_retries_.load()};
+}
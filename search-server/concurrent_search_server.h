@@ -0,0 +1,131 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+struct ConcurrentSearchStats {
+    // Число опубликованных версий индекса
+    uint64_t published_versions = 0;
+
+    // Сколько раз читатель попадал на смену версии и повторял вход
+    uint64_t reader_retries = 0;
+};
+
+// Поиск, не блокирующийся на время изменений индекса. Хранятся две копии индекса:
+// читатели работают с опубликованной, единственный писатель применяет изменение к другой,
+// атомарно публикует её, дожидается ухода читателей со старой копии и повторяет на ней
+// то же изменение. Каждый запрос видит одну целую версию индекса.
+// Изменения должны быть детерминированными: обе копии обязаны прийти в одно состояние
+class ConcurrentSearchServer {
+public:
+    using MatchResult = std::tuple<std::vector<std::string>, DocumentStatus>;
+
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words);
+
+    explicit ConcurrentSearchServer(const std::string& stop_words_text);
+
+    explicit ConcurrentSearchServer(std::string_view stop_words_text);
+
+    ConcurrentSearchServer(const ConcurrentSearchServer&) = delete;
+
+    ConcurrentSearchServer& operator=(const ConcurrentSearchServer&) = delete;
+
+    // Изменения выполняются по одному. Если изменение выбросило исключение, оно
+    // всё равно применяется к обеим копиям, и исключение передаётся вызывающему
+    void Modify(const std::function<void(SearchServer&)>& mutation);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+
+    void RemoveDocument(int document_id);
+
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    void UpdateDocumentStatus(int document_id, DocumentStatus status);
+
+    void UpdateDocumentRating(int document_id, const std::vector<int>& ratings);
+
+    void UpdateDocument(int document_id, std::string_view document);
+
+    // Выполняет function(const SearchServer&) над опубликованной версией. Ссылки на данные
+    // индекса действительны только внутри function
+    template <typename Function>
+    auto Read(Function function) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Слова копируются: после выхода из чтения копия индекса может измениться
+    MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    uint64_t GetIndexVersion() const;
+
+    ConcurrentSearchStats GetStats() const;
+
+private:
+    static const size_t STRIPE_COUNT = 16;
+
+    // Счётчики читателей каждой копии, разнесённые по потокам, чтобы читатели
+    // разных потоков не конкурировали за одну строку кэша
+    struct alignas(64) ReaderStripe {
+        std::array<std::atomic<int>, 2> readers{};
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentSearchServer& server);
+
+        ReadGuard(const ReadGuard&) = delete;
+
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard();
+
+        const SearchServer& GetSearchServer() const;
+
+    private:
+        const ConcurrentSearchServer& server_;
+
+        std::atomic<int>* readers_;
+
+        int side_;
+    };
+
+    std::array<SearchServer, 2> servers_;
+
+    std::atomic<int> active_side_{0};
+
+    mutable std::array<ReaderStripe, STRIPE_COUNT> stripes_;
+
+    std::mutex writer_mutex_;
+
+    std::atomic<uint64_t> published_versions_{0};
+
+    mutable std::atomic<uint64_t> reader_retries_{0};
+
+    void WaitForReaders(int side) const;
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words)
+        : servers_{SearchServer(stop_words), SearchServer(stop_words)} {}
+
+template <typename Function>
+auto ConcurrentSearchServer::Read(Function function) const {
+    const ReadGuard guard(*this);
+    return function(guard.GetSearchServer());
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Плотное битовое множество порядковых номеров документов. Растёт по мере
+// установки битов; номера за пределами выделенной памяти считаются неустановленными
+class DocumentBitmap {
+public:
+    void Set(int ordinal) {
+        const size_t word = static_cast<size_t>(ordinal) / WORD_BITS;
+        if (word >= words_.size()) {
+            words_.resize(word + 1, 0);
+        }
+        words_[word] |= uint64_t{1} << (ordinal % WORD_BITS);
+    }
+
+    void Reset(int ordinal) {
+        const size_t word = static_cast<size_t>(ordinal) / WORD_BITS;
+        if (word < words_.size()) {
+            words_[word] &= ~(uint64_t{1} << (ordinal % WORD_BITS));
+        }
+    }
+
+    bool Test(int ordinal) const {
+        const size_t word = static_cast<size_t>(ordinal) / WORD_BITS;
+        return word < words_.size() && ((words_[word] >> (ordinal % WORD_BITS)) & 1) != 0;
+    }
+
+    // Сбрасывает все биты, сохраняя выделенную память
+    void Clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+    }
+
+private:
+    static const int WORD_BITS = 64;
+
+    std::vector<uint64_t> words_;
+};
@@ -0,0 +1,77 @@
+#include "document_table.h"
+
+int DocumentTable::Add(int document_id, int rating, DocumentStatus status, double inv_word_count) {
+    const int ordinal = GetOrdinalCount();
+    ordinals_.emplace(document_id, ordinal);
+    document_ids_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    inv_word_counts_.push_back(inv_word_count);
+    alive_.push_back(1);
+    status_bitmaps_[static_cast<size_t>(status)].Set(ordinal);
+    return ordinal;
+}
+
+void DocumentTable::Remove(int ordinal) {
+    ordinals_.erase(document_ids_[ordinal]);
+    alive_[ordinal] = 0;
+    status_bitmaps_[static_cast<size_t>(statuses_[ordinal])].Reset(ordinal);
+}
+
+void DocumentTable::SetStatus(int ordinal, DocumentStatus status) {
+    status_bitmaps_[static_cast<size_t>(statuses_[ordinal])].Reset(ordinal);
+    statuses_[ordinal] = status;
+    status_bitmaps_[static_cast<size_t>(status)].Set(ordinal);
+}
+
+std::vector<int> DocumentTable::Compact() {
+    std::vector<int> new_ordinals(GetOrdinalCount(), -1);
+    int live_count = 0;
+    for (int ordinal = 0; ordinal < GetOrdinalCount(); ++ordinal) {
+        if (!IsAlive(ordinal)) {
+            continue;
+        }
+        const int new_ordinal = live_count++;
+        new_ordinals[ordinal] = new_ordinal;
+        document_ids_[new_ordinal] = document_ids_[ordinal];
+        ratings_[new_ordinal] = ratings_[ordinal];
+        statuses_[new_ordinal] = statuses_[ordinal];
+        inv_word_counts_[new_ordinal] = inv_word_counts_[ordinal];
+        alive_[new_ordinal] = 1;
+        ordinals_[document_ids_[new_ordinal]] = new_ordinal;
+    }
+    document_ids_.resize(live_count);
+    ratings_.resize(live_count);
+    statuses_.resize(live_count);
+    inv_word_counts_.resize(live_count);
+    alive_.resize(live_count);
+    document_ids_.shrink_to_fit();
+    ratings_.shrink_to_fit();
+    statuses_.shrink_to_fit();
+    inv_word_counts_.shrink_to_fit();
+    alive_.shrink_to_fit();
+    for (DocumentBitmap& status_bitmap : status_bitmaps_) {
+        status_bitmap = DocumentBitmap();
+    }
+    for (int ordinal = 0; ordinal < live_count; ++ordinal) {
+        status_bitmaps_[static_cast<size_t>(statuses_[ordinal])].Set(ordinal);
+    }
+    return new_ordinals;
+}
+
+bool DocumentTable::Contains(int document_id) const {
+    return ordinals_.count(document_id) > 0;
+}
+
+int DocumentTable::FindOrdinal(int document_id) const {
+    const auto it = ordinals_.find(document_id);
+    return it == ordinals_.end() ? -1 : it->second;
+}
+
+int DocumentTable::GetOrdinal(int document_id) const {
+    return ordinals_.at(document_id);
+}
+
+int DocumentTable::GetLiveCount() const {
+    return static_cast<int>(ordinals_.size());
+}
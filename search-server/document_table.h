@@ -0,0 +1,93 @@
+#pragma once
+
+#include "document.h"
+#include "document_bitmap.h"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Метаданные документов в виде отдельных плотных столбцов, индексируемых внутренним
+// порядковым номером документа (ordinal). Номера выдаются по возрастанию при добавлении
+// и не переиспользуются: удалённый документ лишь помечается как неживой, пока Compact
+// не перенумерует живые документы
+class DocumentTable {
+public:
+    int Add(int document_id, int rating, DocumentStatus status, double inv_word_count);
+
+    void Remove(int ordinal);
+
+    bool Contains(int document_id) const;
+
+    // Возвращает -1, если документа с таким id нет
+    int FindOrdinal(int document_id) const;
+
+    // Выбрасывает std::out_of_range, если документа с таким id нет
+    int GetOrdinal(int document_id) const;
+
+    int GetLiveCount() const;
+
+    // Число удалённых документов, номера которых ещё заняты
+    int GetTombstoneCount() const {
+        return GetOrdinalCount() - GetLiveCount();
+    }
+
+    // Убирает удалённые документы и нумерует живые подряд с сохранением порядка.
+    // Возвращает новый номер для каждого старого, -1 для удалённых
+    std::vector<int> Compact();
+
+    int GetOrdinalCount() const {
+        return static_cast<int>(document_ids_.size());
+    }
+
+    int GetDocumentId(int ordinal) const {
+        return document_ids_[ordinal];
+    }
+
+    int GetRating(int ordinal) const {
+        return ratings_[ordinal];
+    }
+
+    DocumentStatus GetStatus(int ordinal) const {
+        return statuses_[ordinal];
+    }
+
+    double GetInvWordCount(int ordinal) const {
+        return inv_word_counts_[ordinal];
+    }
+
+    void SetRating(int ordinal, int rating) {
+        ratings_[ordinal] = rating;
+    }
+
+    void SetStatus(int ordinal, DocumentStatus status);
+
+    void SetInvWordCount(int ordinal, double inv_word_count) {
+        inv_word_counts_[ordinal] = inv_word_count;
+    }
+
+    bool IsAlive(int ordinal) const {
+        return alive_[ordinal] != 0;
+    }
+
+    // Живые документы с данным статусом
+    const DocumentBitmap& GetStatusBitmap(DocumentStatus status) const {
+        return status_bitmaps_[static_cast<size_t>(status)];
+    }
+
+private:
+    std::unordered_map<int, int> ordinals_;
+
+    std::vector<int> document_ids_;
+
+    std::vector<int> ratings_;
+
+    std::vector<DocumentStatus> statuses_;
+
+    std::vector<double> inv_word_counts_;
+
+    std::vector<uint8_t> alive_;
+
+    std::array<DocumentBitmap, static_cast<size_t>(DocumentStatus::REMOVED) + 1> status_bitmaps_;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Финальное перемешивание 64-битного хеша (как в MurmurHash3): каждый бит результата
+// зависит от всех битов аргумента
+inline uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
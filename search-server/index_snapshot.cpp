@@ -0,0 +1,538 @@
+#include "index_snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+
+const size_t SNAPSHOT_ALIGNMENT = 8;
+
+// Смещения начинаются с нуля и не убывают
+template <typename Offset>
+bool AreOffsetsValid(const Offset* offsets, size_t count) {
+    return offsets[0] == 0 && std::is_sorted(offsets, offsets + count + 1);
+}
+
+bool AreOrdinalsValid(const Posting* first, const Posting* last, size_t document_count) {
+    return std::all_of(first, last, [document_count](const Posting& posting) {
+        return posting.document_id >= 0 && static_cast<size_t>(posting.document_id) < document_count;
+    });
+}
+
+// Заменяет target файлом source; std::rename в Windows не заменяет существующий файл
+bool ReplaceSnapshotFile(const std::string& source, const std::string& target) {
+#ifdef _WIN32
+    return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+// Отображает файл в память только для чтения и возвращает адрес и размер отображения
+std::pair<const char*, size_t> MapFile(const std::string& path) {
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open snapshot file "s + path);
+    }
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size) || static_cast<uint64_t>(file_size.QuadPart) < sizeof(SnapshotHeader)) {
+        CloseHandle(file);
+        throw std::runtime_error("Snapshot file "s + path + " is truncated"s);
+    }
+    const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error("Cannot map snapshot file "s + path);
+    }
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr) {
+        throw std::runtime_error("Cannot map snapshot file "s + path);
+    }
+    return {static_cast<const char*>(data), static_cast<size_t>(file_size.QuadPart)};
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open snapshot file "s + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        throw std::runtime_error("Snapshot file "s + path + " is truncated"s);
+    }
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot file "s + path);
+    }
+    return {static_cast<const char*>(data), size};
+#endif
+}
+
+void UnmapFile(const char* data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+}
+
+// Контрольная сумма считается по 8-байтовым словам; все секции дополняются до
+// границы 8 байт, поэтому её можно вычислять по мере записи
+class SnapshotChecksum {
+public:
+    void Update(const char* data, size_t size) {
+        for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(uint64_t));
+            hash_ = (hash_ ^ word) * 0x100000001B3ull;
+            hash_ ^= hash_ >> 29;
+        }
+    }
+
+    uint64_t Get() const {
+        return hash_;
+    }
+
+private:
+    uint64_t hash_ = 0xCBF29CE484222325ull;
+};
+
+// Пишет снимок во временный файл рядом с целевым и заменяет целевой только готовым снимком:
+// открытые MappedSearchServer продолжают читать прежний файл, а не обрезанный
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path)
+            : path_(path), temp_path_(path + ".tmp"s), out_(temp_path_, std::ios::binary | std::ios::trunc) {
+        if (!out_) {
+            throw std::runtime_error("Cannot open snapshot file "s + temp_path_);
+        }
+        const SnapshotHeader empty_header{};
+        out_.write(reinterpret_cast<const char*>(&empty_header), sizeof(SnapshotHeader));
+        size_ = sizeof(SnapshotHeader);
+    }
+
+    ~SnapshotWriter() {
+        if (!finished_) {
+            out_.close();
+            std::remove(temp_path_.c_str());
+        }
+    }
+
+    template <typename T>
+    SnapshotSection Write(const std::vector<T>& values) {
+        const SnapshotSection section{size_, values.size()};
+        const size_t byte_count = values.size() * sizeof(T);
+        const char* data = reinterpret_cast<const char*>(values.data());
+        const size_t aligned_count = byte_count / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+        out_.write(data, aligned_count);
+        checksum_.Update(data, aligned_count);
+        if (aligned_count != byte_count) {
+            char tail[SNAPSHOT_ALIGNMENT] = {};
+            std::memcpy(tail, data + aligned_count, byte_count - aligned_count);
+            out_.write(tail, SNAPSHOT_ALIGNMENT);
+            checksum_.Update(tail, SNAPSHOT_ALIGNMENT);
+        }
+        size_ += (byte_count + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+        return section;
+    }
+
+    void Finish(SnapshotHeader& header) {
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.checksum = checksum_.Get();
+        header.file_size = size_;
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+        out_.close();
+        if (!out_) {
+            throw std::runtime_error("Cannot write snapshot file"s);
+        }
+        if (!ReplaceSnapshotFile(temp_path_, path_)) {
+            throw std::runtime_error("Cannot replace snapshot file "s + path_);
+        }
+        finished_ = true;
+    }
+
+private:
+    std::string path_;
+
+    std::string temp_path_;
+
+    std::ofstream out_;
+
+    bool finished_ = false;
+
+    SnapshotChecksum checksum_;
+
+    uint64_t size_ = 0;
+};
+
+template <typename Strings>
+std::pair<std::vector<uint32_t>, std::vector<char>> PackStrings(const Strings& strings) {
+    std::vector<uint32_t> offsets;
+    std::vector<char> chars;
+    offsets.reserve(strings.size() + 1);
+    offsets.push_back(0);
+    for (std::string_view str : strings) {
+        chars.insert(chars.end(), str.begin(), str.end());
+        offsets.push_back(static_cast<uint32_t>(chars.size()));
+    }
+    return {offsets, chars};
+}
+
+}
+
+void SaveIndexSnapshot(const SearchServer& search_server, const std::string& path) {
+    const DocumentTable& documents = search_server.documents_;
+    std::vector<int> new_ordinals(documents.GetOrdinalCount(), -1);
+    std::vector<int32_t> document_ids;
+    std::vector<int32_t> document_ratings;
+    std::vector<uint8_t> document_statuses;
+    std::vector<double> document_inv_word_counts;
+    for (const int document_id : search_server.document_ids_) {
+        const int ordinal = documents.GetOrdinal(document_id);
+        new_ordinals[ordinal] = static_cast<int>(document_ids.size());
+        document_ids.push_back(document_id);
+        document_ratings.push_back(documents.GetRating(ordinal));
+        document_statuses.push_back(static_cast<uint8_t>(documents.GetStatus(ordinal)));
+        document_inv_word_counts.push_back(documents.GetInvWordCount(ordinal));
+    }
+
+    std::vector<std::pair<std::string_view, int>> terms;
+    for (const auto [word, term_id] : search_server.term_ids_) {
+        if (search_server.word_document_counts_[term_id] > 0) {
+            terms.emplace_back(word, term_id);
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+    std::vector<int> term_indexes(search_server.word_to_document_freqs_.size(), -1);
+    std::vector<std::string_view> term_words;
+    std::vector<double> term_log_document_freqs;
+    std::vector<uint64_t> posting_offsets = {0};
+    std::vector<Posting> postings;
+    for (const auto& [word, term_id] : terms) {
+        term_indexes[term_id] = static_cast<int>(term_words.size());
+        term_words.push_back(word);
+        term_log_document_freqs.push_back(search_server.word_log_document_freqs_[term_id]);
+        const size_t first = postings.size();
+        search_server.word_to_document_freqs_[term_id].ForEach([&](int ordinal, int term_count) {
+            if (new_ordinals[ordinal] >= 0) {
+                postings.push_back({new_ordinals[ordinal], term_count});
+            }
+        });
+        std::sort(postings.begin() + first, postings.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.document_id < rhs.document_id;
+        });
+        posting_offsets.push_back(postings.size());
+    }
+
+    std::vector<uint64_t> forward_offsets = {0};
+    std::vector<SnapshotForwardEntry> forward_entries;
+    for (size_t new_ordinal = 0; new_ordinal < document_ids.size(); ++new_ordinal) {
+        for (const auto [word, term_freq] : search_server.GetWordFrequencies(document_ids[new_ordinal])) {
+            const int term_index = term_indexes[search_server.term_ids_.at(word)];
+            const auto term_count = static_cast<uint32_t>(std::llround(term_freq / document_inv_word_counts[new_ordinal]));
+            forward_entries.push_back({static_cast<uint32_t>(term_index), term_count});
+        }
+        forward_offsets.push_back(forward_entries.size());
+    }
+
+    const auto [stop_word_offsets, stop_word_chars] = PackStrings(search_server.stop_words_);
+    const auto [term_offsets, term_chars] = PackStrings(term_words);
+
+    SnapshotWriter writer(path);
+    SnapshotHeader header{};
+    header.stop_word_offsets = writer.Write(stop_word_offsets);
+    header.stop_word_chars = writer.Write(stop_word_chars);
+    header.term_offsets = writer.Write(term_offsets);
+    header.term_chars = writer.Write(term_chars);
+    header.term_log_document_freqs = writer.Write(term_log_document_freqs);
+    header.posting_offsets = writer.Write(posting_offsets);
+    header.postings = writer.Write(postings);
+    header.document_ids = writer.Write(document_ids);
+    header.document_ratings = writer.Write(document_ratings);
+    header.document_statuses = writer.Write(document_statuses);
+    header.document_inv_word_counts = writer.Write(document_inv_word_counts);
+    header.forward_offsets = writer.Write(forward_offsets);
+    header.forward_entries = writer.Write(forward_entries);
+    writer.Finish(header);
+}
+
+MappedSearchServer::MappedSearchServer(const std::string& path, bool verify_checksum) {
+    std::tie(data_, size_) = MapFile(path);
+    header_ = reinterpret_cast<const SnapshotHeader*>(data_);
+    try {
+        if (std::memcmp(header_->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            throw std::runtime_error("File "s + path + " is not an index snapshot"s);
+        }
+        if (header_->version != SNAPSHOT_VERSION) {
+            throw std::runtime_error("Unsupported snapshot version "s + std::to_string(header_->version));
+        }
+        if (header_->file_size != size_) {
+            throw std::runtime_error("Snapshot file "s + path + " is truncated"s);
+        }
+        if (verify_checksum) {
+            SnapshotChecksum checksum;
+            checksum.Update(data_ + sizeof(SnapshotHeader), size_ - sizeof(SnapshotHeader));
+            if (checksum.Get() != header_->checksum) {
+                throw std::runtime_error("Snapshot checksum mismatch"s);
+            }
+        }
+        // Секции смещений содержат хотя бы завершающее смещение; без проверки count - 1 переполнится
+        if (header_->stop_word_offsets.count == 0 || header_->term_offsets.count == 0
+            || header_->document_ids.count > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+            throw std::runtime_error("Snapshot section is corrupted"s);
+        }
+        const size_t stop_word_count = header_->stop_word_offsets.count - 1;
+        const size_t term_count = header_->term_offsets.count - 1;
+        const size_t document_count = header_->document_ids.count;
+        stop_word_offsets_ = GetSection<uint32_t>(header_->stop_word_offsets, stop_word_count + 1);
+        stop_word_chars_ = GetSection<char>(header_->stop_word_chars, stop_word_offsets_[stop_word_count]);
+        term_offsets_ = GetSection<uint32_t>(header_->term_offsets, term_count + 1);
+        term_chars_ = GetSection<char>(header_->term_chars, term_offsets_[term_count]);
+        term_log_document_freqs_ = GetSection<double>(header_->term_log_document_freqs, term_count);
+        posting_offsets_ = GetSection<uint64_t>(header_->posting_offsets, term_count + 1);
+        postings_ = GetSection<Posting>(header_->postings, posting_offsets_[term_count]);
+        document_ids_ = GetSection<int32_t>(header_->document_ids, document_count);
+        document_ratings_ = GetSection<int32_t>(header_->document_ratings, document_count);
+        document_statuses_ = GetSection<uint8_t>(header_->document_statuses, document_count);
+        document_inv_word_counts_ = GetSection<double>(header_->document_inv_word_counts, document_count);
+        forward_offsets_ = GetSection<uint64_t>(header_->forward_offsets, document_count + 1);
+        forward_entries_ = GetSection<SnapshotForwardEntry>(header_->forward_entries, forward_offsets_[document_count]);
+        ValidateOffsets();
+        for (size_t ordinal = 0; ordinal < document_count; ++ordinal) {
+            if (document_statuses_[ordinal] >= status_bitmaps_.size()) {
+                throw std::runtime_error("Snapshot document statuses are corrupted"s);
+            }
+            status_bitmaps_[document_statuses_[ordinal]].Set(static_cast<int>(ordinal));
+        }
+        if (verify_checksum) {
+            ValidatePostings();
+        } else {
+            validated_terms_.reset(new std::atomic<bool>[term_count]());
+        }
+    } catch (...) {
+        UnmapFile(data_, size_);
+        throw;
+    }
+    log_document_count_ = SearchServer::ComputeLogCount(GetDocumentCount());
+}
+
+MappedSearchServer::~MappedSearchServer() {
+    UnmapFile(data_, size_);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+    return FindTopDocuments(raw_query, StatusFilter{&status_bitmaps_[static_cast<size_t>(status)]}, max_result_count);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> MappedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    const int ordinal = FindOrdinal(document_id);
+    if (ordinal < 0) {
+        throw std::out_of_range("Invalid document_id"s);
+    }
+    const auto status = static_cast<DocumentStatus>(document_statuses_[ordinal]);
+    const Query query = ParseQuery(raw_query);
+    std::vector<std::string_view> matched_words;
+    for (std::string_view word : query.minus_words) {
+        const int term_index = FindTermId(word);
+        if (term_index >= 0 && ContainsDocument(term_index, ordinal)) {
+            return {matched_words, status};
+        }
+    }
+    for (std::string_view word : query.plus_words) {
+        const int term_index = FindTermId(word);
+        if (term_index >= 0 && ContainsDocument(term_index, ordinal)) {
+            matched_words.push_back(GetTerm(term_index));
+        }
+    }
+    return {matched_words, status};
+}
+
+std::map<std::string_view, double> MappedSearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> word_freqs;
+    const int ordinal = FindOrdinal(document_id);
+    if (ordinal < 0) {
+        return word_freqs;
+    }
+    for (uint64_t i = forward_offsets_[ordinal]; i < forward_offsets_[ordinal + 1]; ++i) {
+        if (forward_entries_[i].term_index >= header_->term_offsets.count - 1) {
+            throw std::runtime_error("Snapshot postings are corrupted"s);
+        }
+        word_freqs.emplace_hint(word_freqs.end(), GetTerm(forward_entries_[i].term_index),
+                                forward_entries_[i].term_count * document_inv_word_counts_[ordinal]);
+    }
+    return word_freqs;
+}
+
+int MappedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(header_->document_ids.count);
+}
+
+const int32_t* MappedSearchServer::begin() const {
+    return document_ids_;
+}
+
+const int32_t* MappedSearchServer::end() const {
+    return document_ids_ + GetDocumentCount();
+}
+
+template <typename T>
+const T* MappedSearchServer::GetSection(const SnapshotSection& section, size_t expected_count) const {
+    if (section.count != expected_count
+        || section.offset % alignof(T) != 0
+        || section.offset > size_
+        || section.count > (size_ - section.offset) / sizeof(T)) {
+        throw std::runtime_error("Snapshot section is corrupted"s);
+    }
+    return reinterpret_cast<const T*>(data_ + section.offset);
+}
+
+void MappedSearchServer::ValidateOffsets() const {
+    const size_t stop_word_count = header_->stop_word_offsets.count - 1;
+    const size_t term_count = header_->term_offsets.count - 1;
+    const size_t document_count = header_->document_ids.count;
+    // Последнее смещение каждой секции уже совпадает с размером секции данных
+    if (!AreOffsetsValid(stop_word_offsets_, stop_word_count) || !AreOffsetsValid(term_offsets_, term_count)
+        || !AreOffsetsValid(posting_offsets_, term_count) || !AreOffsetsValid(forward_offsets_, document_count)) {
+        throw std::runtime_error("Snapshot offsets are corrupted"s);
+    }
+}
+
+void MappedSearchServer::ValidatePostings() const {
+    const size_t term_count = header_->term_offsets.count - 1;
+    const size_t document_count = header_->document_ids.count;
+    const bool are_postings_valid = AreOrdinalsValid(postings_, postings_ + posting_offsets_[term_count], document_count);
+    const bool are_forward_entries_valid = std::all_of(forward_entries_, forward_entries_ + forward_offsets_[document_count],
+                                                       [term_count](const SnapshotForwardEntry& entry) {
+                                                           return entry.term_index < term_count;
+                                                       });
+    if (!are_postings_valid || !are_forward_entries_valid) {
+        throw std::runtime_error("Snapshot postings are corrupted"s);
+    }
+}
+
+void MappedSearchServer::ValidateTermPostings(int term_index) const {
+    if (!validated_terms_ || validated_terms_[term_index].load(std::memory_order_acquire)) {
+        return;
+    }
+    if (!AreOrdinalsValid(postings_ + posting_offsets_[term_index], postings_ + posting_offsets_[term_index + 1],
+                          header_->document_ids.count)) {
+        throw std::runtime_error("Snapshot postings are corrupted"s);
+    }
+    validated_terms_[term_index].store(true, std::memory_order_release);
+}
+
+std::string_view MappedSearchServer::GetStopWord(size_t index) const {
+    return {stop_word_chars_ + stop_word_offsets_[index], stop_word_offsets_[index + 1] - stop_word_offsets_[index]};
+}
+
+std::string_view MappedSearchServer::GetTerm(size_t term_index) const {
+    return {term_chars_ + term_offsets_[term_index], term_offsets_[term_index + 1] - term_offsets_[term_index]};
+}
+
+bool MappedSearchServer::IsStopWord(std::string_view word) const {
+    size_t left = 0;
+    size_t right = header_->stop_word_offsets.count - 1;
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
+        if (GetStopWord(middle) < word) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    return left < header_->stop_word_offsets.count - 1 && GetStopWord(left) == word;
+}
+
+MappedSearchServer::Query MappedSearchServer::ParseQuery(std::string_view text) const {
+    Query result;
+    SearchServer::ParseQuery(text, [this](std::string_view word) {
+        return IsStopWord(word);
+    }, result);
+    return result;
+}
+
+DocumentBitmap MappedSearchServer::BuildExclusionBitmap(const Query& query) const {
+    DocumentBitmap excluded;
+    for (std::string_view word : query.minus_words) {
+        const int term_index = FindTermId(word);
+        if (term_index < 0) {
+            continue;
+        }
+        for (uint64_t i = posting_offsets_[term_index]; i < posting_offsets_[term_index + 1]; ++i) {
+            excluded.Set(postings_[i].document_id);
+        }
+    }
+    return excluded;
+}
+
+int MappedSearchServer::FindTermId(std::string_view word) const {
+    size_t left = 0;
+    size_t right = header_->term_offsets.count - 1;
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
+        if (GetTerm(middle) < word) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    if (left == header_->term_offsets.count - 1 || GetTerm(left) != word) {
+        return -1;
+    }
+    ValidateTermPostings(static_cast<int>(left));
+    return static_cast<int>(left);
+}
+
+double MappedSearchServer::ComputeWordInverseDocumentFreq(const Query& query, std::string_view word, int term_index) const {
+    if (query.inverse_document_freqs != nullptr) {
+        const auto it = query.inverse_document_freqs->find(word);
+        if (it != query.inverse_document_freqs->end()) {
+            return it->second;
+        }
+    }
+    return log_document_count_ - term_log_document_freqs_[term_index];
+}
+
+int MappedSearchServer::FindOrdinal(int document_id) const {
+    const int32_t* it = std::lower_bound(begin(), end(), document_id);
+    return it != end() && *it == document_id ? static_cast<int>(it - begin()) : -1;
+}
+
+bool MappedSearchServer::ContainsDocument(int term_index, int ordinal) const {
+    const Posting* first = postings_ + posting_offsets_[term_index];
+    const Posting* last = postings_ + posting_offsets_[term_index + 1];
+    const Posting* it = std::lower_bound(first, last, ordinal, [](const Posting& posting, int ordinal) {
+        return posting.document_id < ordinal;
+    });
+    return it != last && it->document_id == ordinal;
+}
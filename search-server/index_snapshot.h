@@ -0,0 +1,209 @@
+#pragma once
+
+#include "document.h"
+#include "document_bitmap.h"
+#include "postings.h"
+#include "relevance_accumulator.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Бинарный снимок индекса. Все массивы выровнены по 8 байт и записываются в порядке байт
+// текущей платформы, поэтому после отображения файла в память их можно читать без разбора
+struct SnapshotSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapshotForwardEntry {
+    uint32_t term_index;
+    uint32_t term_count;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t checksum;
+    uint64_t file_size;
+    SnapshotSection stop_word_offsets;
+    SnapshotSection stop_word_chars;
+    SnapshotSection term_offsets;
+    SnapshotSection term_chars;
+    SnapshotSection term_log_document_freqs;
+    SnapshotSection posting_offsets;
+    SnapshotSection postings;
+    SnapshotSection document_ids;
+    SnapshotSection document_ratings;
+    SnapshotSection document_statuses;
+    SnapshotSection document_inv_word_counts;
+    SnapshotSection forward_offsets;
+    SnapshotSection forward_entries;
+};
+
+const uint32_t SNAPSHOT_VERSION = 1;
+
+void SaveIndexSnapshot(const SearchServer& search_server, const std::string& path);
+
+// Поисковый сервер только для чтения, работающий прямо поверх отображённого в память снимка.
+// Разбор запроса и подсчёт релевантности те же, что у SearchServer
+class MappedSearchServer {
+public:
+    // Размеры секций и смещения проверяются всегда. verify_checksum дополнительно сверяет
+    // контрольную сумму и номера документов и слов во всём файле; без него открытие не читает
+    // вхождения, а номера документов во вхождениях слова проверяются при первом обращении к нему
+    explicit MappedSearchServer(const std::string& path, bool verify_checksum = true);
+
+    MappedSearchServer(const MappedSearchServer&) = delete;
+
+    MappedSearchServer& operator=(const MappedSearchServer&) = delete;
+
+    ~MappedSearchServer();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    int GetDocumentCount() const;
+
+    const int32_t* begin() const;
+
+    const int32_t* end() const;
+
+private:
+    friend class SearchServer;
+
+    using Query = SearchServer::Query;
+
+    using StatusFilter = SearchServer::StatusFilter;
+
+    const char* data_ = nullptr;
+
+    size_t size_ = 0;
+
+    const SnapshotHeader* header_ = nullptr;
+
+    const uint32_t* stop_word_offsets_ = nullptr;
+
+    const char* stop_word_chars_ = nullptr;
+
+    const uint32_t* term_offsets_ = nullptr;
+
+    const char* term_chars_ = nullptr;
+
+    const double* term_log_document_freqs_ = nullptr;
+
+    const uint64_t* posting_offsets_ = nullptr;
+
+    const Posting* postings_ = nullptr;
+
+    const int32_t* document_ids_ = nullptr;
+
+    const int32_t* document_ratings_ = nullptr;
+
+    const uint8_t* document_statuses_ = nullptr;
+
+    const double* document_inv_word_counts_ = nullptr;
+
+    const uint64_t* forward_offsets_ = nullptr;
+
+    const SnapshotForwardEntry* forward_entries_ = nullptr;
+
+    double log_document_count_ = 0.0;
+
+    // Документы с каждым статусом; строятся при открытии по секции статусов
+    std::array<DocumentBitmap, static_cast<size_t>(DocumentStatus::REMOVED) + 1> status_bitmaps_;
+
+    // Слова, вхождения которых уже проверены; пусто, если при открытии проверен весь файл
+    std::unique_ptr<std::atomic<bool>[]> validated_terms_;
+
+    template <typename T>
+    const T* GetSection(const SnapshotSection& section, size_t expected_count) const;
+
+    // Проверяет, что смещения начинаются с нуля и не убывают
+    void ValidateOffsets() const;
+
+    // Проверяет, что номера документов и слов во всех вхождениях не выходят за границы секций
+    void ValidatePostings() const;
+
+    void ValidateTermPostings(int term_index) const;
+
+    std::string_view GetStopWord(size_t index) const;
+
+    std::string_view GetTerm(size_t term_index) const;
+
+    bool IsStopWord(std::string_view word) const;
+
+    Query ParseQuery(std::string_view text) const;
+
+    int FindTermId(std::string_view word) const;
+
+    double ComputeWordInverseDocumentFreq(const Query& query, std::string_view word, int term_index) const;
+
+    template <typename Visitor>
+    void ForEachPosting(int term_index, Visitor visitor) const {
+        for (uint64_t i = posting_offsets_[term_index]; i < posting_offsets_[term_index + 1]; ++i) {
+            visitor(postings_[i].document_id, postings_[i].term_count);
+        }
+    }
+
+    template <typename DocumentPredicate>
+    bool IsAccepted(int ordinal, DocumentPredicate& document_predicate) const {
+        return document_predicate(document_ids_[ordinal], static_cast<DocumentStatus>(document_statuses_[ordinal]), document_ratings_[ordinal]);
+    }
+
+    bool IsAccepted(int ordinal, StatusFilter& status_filter) const {
+        return status_filter.documents->Test(ordinal);
+    }
+
+    int GetOrdinalCount() const {
+        return GetDocumentCount();
+    }
+
+    int GetDocumentId(int ordinal) const {
+        return document_ids_[ordinal];
+    }
+
+    int GetRating(int ordinal) const {
+        return document_ratings_[ordinal];
+    }
+
+    double GetInvWordCount(int ordinal) const {
+        return document_inv_word_counts_[ordinal];
+    }
+
+    DocumentBitmap BuildExclusionBitmap(const Query& query) const;
+
+    int FindOrdinal(int document_id) const;
+
+    bool ContainsDocument(int term_index, int ordinal) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                           size_t max_result_count) const {
+    const Query query = ParseQuery(raw_query);
+    const DocumentBitmap excluded = BuildExclusionBitmap(query);
+    thread_local RelevanceAccumulator accumulator;
+    TopDocuments top_documents(max_result_count);
+    SearchServer::ScoreDocuments(*this, *this, query, document_predicate, excluded, accumulator, top_documents);
+    return top_documents.Extract();
+}
@@ -1,12 +1,26 @@
 #include "search_server.h"
+#include "index_snapshot.h"
 #include "log_duration.h"
+#include "process_queries.h"
+#include "batch_query_executor.h"
+#include "near_duplicates.h"
+#include "concurrent_search_server.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <execution>
 #include <iostream>
 #include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <tbb/global_control.h>
+
 using namespace std;
 
 string GenerateWord(mt19937& generator, int max_length) {
@@ -52,6 +66,28 @@ vector<string> GenerateQueries(mt19937& generator, const vector<string>& diction
     return queries;
 }
 
+// Слова выбираются с вероятностью, обратной их номеру в словаре, как в текстах на естественном языке
+vector<string> GenerateSkewedQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int word_count) {
+    vector<double> weights(dictionary.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<int> word_distribution(weights.begin(), weights.end());
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        string query;
+        for (int j = 0; j < word_count; ++j) {
+            if (!query.empty()) {
+                query.push_back(' ');
+            }
+            query += dictionary[word_distribution(generator)];
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
 template <typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
@@ -66,15 +102,418 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
 
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
+void TestPostingsFormat(string_view mark, SearchServer& search_server, const vector<string>& queries, PostingsFormat format) {
+    search_server.SetPostingsFormat(format);
+    const auto start_time = chrono::steady_clock::now();
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+    cout << mark << ": postings memory = "s << search_server.GetPostingsMemoryUsage() << " bytes, "s
+         << "throughput = "s << queries.size() / duration.count() << " queries/s, "s
+         << "total relevance = "s << total_relevance << endl;
+}
+
+void TestShortQueryLatency(SearchServer& search_server, const vector<string>& queries) {
+    const auto measure = [&](string_view mark, auto policy) {
+        const auto start_time = chrono::steady_clock::now();
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(policy, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        const chrono::duration<double, micro> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << duration.count() / queries.size() << " us per query, total relevance = "s << total_relevance << endl;
+    };
+    measure("short seq"s, execution::seq);
+    search_server.SetParallelQueryMode(ParallelQueryMode::BY_WORDS);
+    measure("short par by words"s, execution::par);
+    search_server.SetParallelQueryMode(ParallelQueryMode::BY_DOCUMENT_RANGES);
+    measure("short par by document ranges"s, execution::par);
+    search_server.SetParallelQueryMode(ParallelQueryMode::AUTO);
+}
+
+void TestMaxScore(SearchServer& search_server, const vector<string>& queries, string_view mark) {
+    for (const RetrievalMode mode : {RetrievalMode::EXHAUSTIVE, RetrievalMode::MAX_SCORE}) {
+        search_server.SetRetrievalMode(mode);
+        search_server.ResetPruningStats();
+        const auto start_time = chrono::steady_clock::now();
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        const chrono::duration<double, micro> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << (mode == RetrievalMode::EXHAUSTIVE ? " exhaustive: "s : " max score: "s)
+             << duration.count() / queries.size() << " us per query, total relevance = "s << total_relevance;
+        if (mode == RetrievalMode::MAX_SCORE) {
+            const PruningStats stats = search_server.GetPruningStats();
+            cout << ", postings skipped = "s << stats.total_postings - stats.scored_postings << " of "s << stats.total_postings;
+        }
+        cout << endl;
+    }
+    search_server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+}
+
+void TestBatchThroughput(const SearchServer& search_server, const vector<string>& queries) {
+    const auto report = [&](string_view mark, auto process) {
+        const auto start_time = chrono::steady_clock::now();
+        size_t document_count = 0;
+        for (const auto& documents : process(queries)) {
+            document_count += documents.size();
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << queries.size() / duration.count() << " queries/s ("s << document_count << " documents)"s << endl;
+    };
+    report("ProcessQueries"s, [&](const vector<string>& batch) {
+        return ProcessQueries(search_server, batch);
+    });
+    for (const bool pin_threads : {false, true}) {
+        BatchQueryExecutor executor(search_server, {0, pin_threads});
+        report(pin_threads ? "BatchQueryExecutor pinned"s : "BatchQueryExecutor"s, [&](const vector<string>& batch) {
+            return executor.ProcessQueries(batch);
+        });
+    }
+}
+
+// Прежнее разбиение: поиск пробелов по одному байту и отдельная проверка каждого слова
+vector<string_view> SplitIntoValidWordsBaseline(string_view text) {
+    vector<string_view> result;
+    auto pos = text.find_first_not_of(' ');
+    while (pos != text.npos) {
+        const auto space = text.find(' ', pos);
+        result.push_back(space == text.npos ? text.substr(pos) : text.substr(pos, space - pos));
+        pos = text.find_first_not_of(' ', space);
+    }
+    for (const string_view word : result) {
+        if (any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+            throw invalid_argument("Word "s + string(word) + " is invalid"s);
+        }
+    }
+    return result;
+}
+
+void TestSplitThroughput(const vector<string>& documents) {
+    const int repeat_count = 20;
+    size_t byte_count = 0;
+    for (const string& document : documents) {
+        byte_count += document.size();
+    }
+    const auto report = [&](string_view mark, auto split) {
+        size_t word_count = 0;
+        const auto start_time = chrono::steady_clock::now();
+        for (int i = 0; i < repeat_count; ++i) {
+            for (const string& document : documents) {
+                word_count += split(document);
+            }
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << byte_count * repeat_count / duration.count() / 1e9 << " GB/s ("s << word_count << " words)"s << endl;
+    };
+    report("split baseline"s, [](string_view text) {
+        return SplitIntoValidWordsBaseline(text).size();
+    });
+    vector<string_view> words;
+    for (const auto& [implementation, mark] : {pair{SplitImplementation::SCALAR, "split scalar"s},
+                                               pair{SplitImplementation::SSE2, "split sse2"s},
+                                               pair{SplitImplementation::AVX2, "split avx2"s}}) {
+        if (IsSplitImplementationSupported(implementation)) {
+            report(mark, [&words, implementation = implementation](string_view text) {
+                SplitIntoWords(text, words, implementation);
+                return words.size();
+            });
+        }
+    }
+}
+
+SearchServer BuildSearchServer(const string& stop_words, const vector<string>& documents) {
+    SearchServer search_server(stop_words);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    return search_server;
+}
+
+void TestRemoval(const string& stop_words, const vector<string>& documents) {
+    vector<int> document_ids;
+    for (size_t i = 0; i < documents.size(); i += 2) {
+        document_ids.push_back(i);
+    }
+    {
+        SearchServer search_server = BuildSearchServer(stop_words, documents);
+        LOG_DURATION("RemoveDocument loop"s);
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(document_id);
+        }
+    }
+    SearchServer search_server = BuildSearchServer(stop_words, documents);
+    search_server.SetCompactionThreshold(1.0);
+    {
+        LOG_DURATION("RemoveDocuments"s);
+        search_server.RemoveDocuments(document_ids);
+    }
+    const size_t memory_usage = search_server.GetPostingsMemoryUsage();
+    {
+        LOG_DURATION("CompactPostings"s);
+        search_server.CompactPostings();
+    }
+    cout << "postings memory: "s << memory_usage << " -> "s << search_server.GetPostingsMemoryUsage() << " bytes"s << endl;
+}
+
+void TestUpdates(mt19937& generator, const vector<string>& dictionary, const vector<string>& documents) {
+    SearchServer search_server = BuildSearchServer(dictionary[0], documents);
+    const int update_count = 1000;
+    vector<int> document_ids(update_count);
+    for (int& document_id : document_ids) {
+        document_id = uniform_int_distribution<int>(0, documents.size() - 1)(generator);
+    }
+    {
+        LOG_DURATION("UpdateDocumentStatus"s);
+        for (const int document_id : document_ids) {
+            search_server.UpdateDocumentStatus(document_id, DocumentStatus::BANNED);
+            search_server.UpdateDocumentStatus(document_id, DocumentStatus::ACTUAL);
+        }
+    }
+    {
+        LOG_DURATION("RemoveDocument + AddDocument"s);
+        for (const int document_id : document_ids) {
+            search_server.RemoveDocument(document_id);
+            search_server.AddDocument(document_id, documents[document_id], DocumentStatus::BANNED, {1, 2, 3});
+        }
+    }
+    // Новый текст отличается от старого последним словом
+    vector<string> texts;
+    texts.reserve(update_count);
+    for (const int document_id : document_ids) {
+        const string& text = documents[document_id];
+        texts.push_back(text.substr(0, text.rfind(' ') + 1) + GenerateWord(generator, 10));
+    }
+    {
+        LOG_DURATION("UpdateDocument"s);
+        for (int i = 0; i < update_count; ++i) {
+            search_server.UpdateDocument(document_ids[i], texts[i]);
+        }
+    }
+}
+
+void TestConcurrentReads(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    ConcurrentSearchServer search_server(stop_words);
+    vector<DocumentInput> batch;
+    batch.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+    search_server.AddDocuments(batch);
+    const size_t reader_count = max(2u, thread::hardware_concurrency());
+    for (const bool with_writes : {false, true}) {
+        atomic<bool> is_reading{true};
+        thread writer([&] {
+            for (int document_id = 0; with_writes && is_reading; document_id = (document_id + 1) % documents.size()) {
+                search_server.UpdateDocumentStatus(document_id, DocumentStatus::BANNED);
+                search_server.UpdateDocumentStatus(document_id, DocumentStatus::ACTUAL);
+            }
+        });
+        const auto start_time = chrono::steady_clock::now();
+        vector<thread> readers;
+        for (size_t reader_index = 0; reader_index < reader_count; ++reader_index) {
+            readers.emplace_back([&, reader_index] {
+                for (size_t i = reader_index; i < queries.size(); i += reader_count) {
+                    search_server.FindTopDocuments(queries[i]);
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        is_reading = false;
+        writer.join();
+        cout << "concurrent reads"s << (with_writes ? " with writes"s : ""s) << ": "s
+             << queries.size() / duration.count() << " queries/s"s << endl;
+    }
+    cout << "published versions: "s << search_server.GetStats().published_versions
+         << ", reader retries: "s << search_server.GetStats().reader_retries << endl;
+}
+
+void TestSegmentedIndex(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    SegmentedSearchServer search_server(stop_words);
+    {
+        LOG_DURATION("SegmentedSearchServer AddDocument"s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    const auto report_queries = [&](string_view mark) {
+        const auto start_time = chrono::steady_clock::now();
+        size_t document_count = 0;
+        for (const string& query : queries) {
+            document_count += search_server.FindTopDocuments(query).size();
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        const SegmentedIndexStats stats = search_server.GetStats();
+        cout << mark << ": "s << queries.size() / duration.count() << " queries/s, "s << stats.sealed_segment_count
+             << " sealed segments, "s << stats.merge_count << " merges of "s << stats.merged_document_count
+             << " documents in "s << stats.merge_seconds << " s, postings "s << stats.postings_memory_usage << " bytes"s << endl;
+    };
+    search_server.WaitForMerges();
+    report_queries("segmented"s);
+    search_server.ForceMerge();
+    report_queries("segmented after ForceMerge"s);
+}
+
+void TestShardedIndex(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    vector<DocumentInput> batch;
+    batch.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+    SearchServer single_server(stop_words);
+    ShardedSearchServer sharded_server(stop_words);
+    {
+        LOG_DURATION("single AddDocuments"s);
+        single_server.AddDocuments(batch);
+    }
+    {
+        LOG_DURATION("sharded AddDocuments"s);
+        sharded_server.AddDocuments(batch);
+    }
+    const auto report_queries = [&queries](string_view mark, const auto& search_server, const auto& policy) {
+        const auto start_time = chrono::steady_clock::now();
+        size_t document_count = 0;
+        for (const string& query : queries) {
+            document_count += search_server.FindTopDocuments(policy, query).size();
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << queries.size() / duration.count() << " queries/s, "s << document_count << " documents"s << endl;
+    };
+    report_queries("single seq"s, single_server, execution::seq);
+    report_queries("single par"s, single_server, execution::par);
+    cout << "shards: "s << sharded_server.GetShardCount() << endl;
+    report_queries("sharded"s, sharded_server, execution::par);
+}
+
+// Копии случайных документов, в которых заменено changed_word_count слов
+vector<pair<size_t, string>> GenerateNearDuplicates(mt19937& generator, const vector<string>& dictionary,
+                                                    const vector<string>& documents, int count, int changed_word_count) {
+    vector<pair<size_t, string>> near_duplicates;
+    near_duplicates.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const size_t source = uniform_int_distribution<size_t>(0, documents.size() - 1)(generator);
+        vector<string> words;
+        string_view text = documents[source];
+        while (!text.empty()) {
+            const size_t space = min(text.find(' '), text.size());
+            words.emplace_back(text.substr(0, space));
+            text.remove_prefix(min(space + 1, text.size()));
+        }
+        for (int j = 0; j < changed_word_count; ++j) {
+            words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] =
+                dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        string document;
+        for (const string& word : words) {
+            document += document.empty() ? word : ' ' + word;
+        }
+        near_duplicates.push_back({source, move(document)});
+    }
+    return near_duplicates;
+}
+
+void TestNearDuplicates(mt19937& generator, const vector<string>& dictionary, const vector<string>& documents) {
+    const auto near_duplicates = GenerateNearDuplicates(generator, dictionary, documents, 1000, 3);
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    for (size_t i = 0; i < near_duplicates.size(); ++i) {
+        search_server.AddDocument(documents.size() + i, near_duplicates[i].second, DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    vector<NearDuplicate> found;
+    {
+        LOG_DURATION("FindNearDuplicates"s);
+        found = FindNearDuplicates(search_server);
+    }
+    size_t injected_count = 0;
+    for (const NearDuplicate& near_duplicate : found) {
+        injected_count += static_cast<size_t>(near_duplicate.document_id) >= documents.size();
+    }
+    cout << "near duplicates: "s << found.size() << " found, "s << injected_count << " of "s
+         << near_duplicates.size() << " injected"s << endl;
+}
+
+void TestSnapshotStartup(const SearchServer& search_server, const vector<string>& queries) {
+    const string path = "search_server.snapshot"s;
+    {
+        LOG_DURATION("SaveIndexSnapshot"s);
+        SaveIndexSnapshot(search_server, path);
+    }
+    for (const bool verify_checksum : {true, false}) {
+        const auto start_time = chrono::steady_clock::now();
+        const MappedSearchServer mapped_server(path, verify_checksum);
+        const auto first_result = mapped_server.FindTopDocuments(queries.front());
+        const chrono::duration<double, milli> duration = chrono::steady_clock::now() - start_time;
+        cout << "snapshot startup"s << (verify_checksum ? " with checksum"s : ""s) << ": "s
+             << duration.count() << " ms to first result ("s << first_result.size() << " documents)"s << endl;
+    }
+    remove(path.c_str());
+}
+
 int main() {
     mt19937 generator;
     const auto dictionary = GenerateDictionary(generator, 1000, 10);
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
     SearchServer search_server(dictionary[0]);
-    for (size_t i = 0; i < documents.size(); ++i) {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    {
+        LOG_DURATION("AddDocument"s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    {
+        vector<DocumentInput> batch;
+        batch.reserve(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            batch.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+        }
+        SearchServer batch_server(dictionary[0]);
+        LOG_DURATION("AddDocuments"s);
+        batch_server.AddDocuments(batch);
     }
+    TestSplitThroughput(documents);
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
+    for (const size_t thread_count : {1u, 2u, 4u, 8u, thread::hardware_concurrency()}) {
+        const tbb::global_control parallelism(tbb::global_control::max_allowed_parallelism, thread_count);
+        cout << "threads: "s << thread_count << endl;
+        TEST(seq);
+        TEST(par);
+    }
+    TestPostingsFormat("plain"s, search_server, queries, PostingsFormat::PLAIN);
+    TestPostingsFormat("compressed"s, search_server, queries, PostingsFormat::COMPRESSED);
+    TestShortQueryLatency(search_server, GenerateQueries(generator, dictionary, 1000, 2));
+    TestMaxScore(search_server, queries, "long queries"s);
+    TestMaxScore(search_server, GenerateQueries(generator, dictionary, 1000, 5), "5-word queries"s);
+    {
+        mt19937 skewed_generator;
+        SearchServer skewed_server(dictionary[0]);
+        const auto skewed_documents = GenerateSkewedQueries(skewed_generator, dictionary, 10'000, 70);
+        for (size_t i = 0; i < skewed_documents.size(); ++i) {
+            skewed_server.AddDocument(i, skewed_documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        TestMaxScore(skewed_server, GenerateSkewedQueries(skewed_generator, dictionary, 1000, 5), "skewed 5-word queries"s);
+    }
+    TestBatchThroughput(search_server, GenerateQueries(generator, dictionary, 2000, 10));
+    TestSnapshotStartup(search_server, queries);
+    TestRemoval(dictionary[0], documents);
+    TestUpdates(generator, dictionary, documents);
+    TestConcurrentReads(dictionary[0], documents, GenerateQueries(generator, dictionary, 2000, 10));
+    TestSegmentedIndex(dictionary[0], documents, GenerateQueries(generator, dictionary, 2000, 10));
+    TestShardedIndex(dictionary[0], documents, GenerateQueries(generator, dictionary, 2000, 10));
+    TestNearDuplicates(generator, dictionary, documents);
 }
\ No newline at end of file
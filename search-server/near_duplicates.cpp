@@ -0,0 +1,163 @@
+#include "near_duplicates.h"
+#include "hash_utils.h"
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <utility>
+
+using namespace std::string_literals;
+
+namespace {
+
+using WordFreqs = std::map<std::string_view, double>;
+
+double ComputeJaccard(const WordFreqs& lhs, const WordFreqs& rhs) {
+    if (lhs.empty() && rhs.empty()) {
+        return 1.0;
+    }
+    size_t common_count = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (lhs_it->first < rhs_it->first) {
+            ++lhs_it;
+        } else if (rhs_it->first < lhs_it->first) {
+            ++rhs_it;
+        } else {
+            ++common_count;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(common_count) / static_cast<double>(lhs.size() + rhs.size() - common_count);
+}
+
+}
+
+std::vector<NearDuplicate> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options,
+                                              NearDuplicateStats* stats) {
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+    std::vector<const WordFreqs*> word_freqs(document_count);
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), word_freqs.begin(),
+                   [&search_server](int document_id) {
+                       return &search_server.GetWordFrequencies(document_id);
+                   });
+    std::vector<size_t> indexes(document_count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    // Подписи хранятся одним массивом: signature_size значений на документ
+    const size_t signature_size = options.band_count * options.rows_per_band;
+    std::vector<uint64_t> hash_seeds(signature_size);
+    for (size_t i = 0; i < signature_size; ++i) {
+        hash_seeds[i] = Mix(options.seed + 0x9e3779b97f4a7c15ULL * (i + 1));
+    }
+    std::vector<uint32_t> signatures(document_count * signature_size);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        uint32_t* signature = signatures.data() + index * signature_size;
+        std::fill(signature, signature + signature_size, std::numeric_limits<uint32_t>::max());
+        for (const auto& [word, term_freq] : *word_freqs[index]) {
+            const uint64_t word_hash = std::hash<std::string_view>{}(word);
+            for (size_t i = 0; i < signature_size; ++i) {
+                signature[i] = std::min(signature[i], static_cast<uint32_t>(Mix(word_hash ^ hash_seeds[i])));
+            }
+        }
+    });
+
+    // Для каждой полосы документы с равным хешем полосы идут подряд по возрастанию id;
+    // каждый сравнивается с несколькими предшественниками по корзине
+    std::vector<size_t> bands(options.band_count);
+    std::iota(bands.begin(), bands.end(), 0);
+    std::vector<std::vector<std::pair<size_t, size_t>>> band_candidates(options.band_count);
+    std::vector<size_t> band_truncated_counts(options.band_count, 0);
+    std::for_each(std::execution::par, bands.begin(), bands.end(), [&](size_t band) {
+        std::vector<std::pair<uint64_t, size_t>> keys(document_count);
+        for (size_t index = 0; index < document_count; ++index) {
+            const uint32_t* rows = signatures.data() + index * signature_size + band * options.rows_per_band;
+            uint64_t key = band;
+            for (size_t row = 0; row < options.rows_per_band; ++row) {
+                key = Mix(key ^ rows[row]);
+            }
+            keys[index] = {key, index};
+        }
+        std::sort(keys.begin(), keys.end());
+        auto& candidates = band_candidates[band];
+        size_t bucket_start = 0;
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (keys[i].first != keys[i - 1].first) {
+                bucket_start = i;
+                continue;
+            }
+            if (i - bucket_start == options.max_bucket_comparisons + 1) {
+                ++band_truncated_counts[band];
+            }
+            for (size_t j = i; j-- > bucket_start && i - j <= options.max_bucket_comparisons;) {
+                candidates.push_back({keys[i].second, keys[j].second});
+            }
+        }
+    });
+    std::vector<std::pair<size_t, size_t>> candidates;
+    for (auto& band : band_candidates) {
+        candidates.insert(candidates.end(), band.begin(), band.end());
+        std::vector<std::pair<size_t, size_t>>().swap(band);
+    }
+    std::sort(std::execution::par, candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    if (stats != nullptr) {
+        stats->candidate_count = candidates.size();
+        stats->truncated_bucket_count = std::accumulate(band_truncated_counts.begin(), band_truncated_counts.end(), size_t{0});
+    }
+
+    std::vector<double> similarities(candidates.size());
+    std::transform(std::execution::par, candidates.begin(), candidates.end(), similarities.begin(),
+                   [&word_freqs](const std::pair<size_t, size_t>& candidate) {
+                       return ComputeJaccard(*word_freqs[candidate.first], *word_freqs[candidate.second]);
+                   });
+
+    // Пары упорядочены по документу, поэтому к моменту проверки документа решение
+    // для всех документов с меньшим id уже принято; удаляемые документы оригиналами не служат
+    std::vector<uint8_t> is_removed(document_count, 0);
+    std::vector<NearDuplicate> near_duplicates;
+    for (size_t i = 0; i < candidates.size();) {
+        const size_t index = candidates[i].first;
+        size_t best = candidates.size();
+        for (; i < candidates.size() && candidates[i].first == index; ++i) {
+            if (similarities[i] >= options.similarity_threshold && !is_removed[candidates[i].second]
+                && (best == candidates.size() || candidates[i].second < candidates[best].second)) {
+                best = i;
+            }
+        }
+        if (best != candidates.size()) {
+            is_removed[index] = 1;
+            near_duplicates.push_back({document_ids[index], document_ids[candidates[best].second], similarities[best]});
+        }
+    }
+    return near_duplicates;
+}
+
+std::vector<NearDuplicate> RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options, std::ostream* out) {
+    NearDuplicateStats stats;
+    const std::vector<NearDuplicate> near_duplicates = FindNearDuplicates(search_server, options, &stats);
+    std::vector<int> document_ids;
+    document_ids.reserve(near_duplicates.size());
+    std::ostringstream report;
+    for (const NearDuplicate& near_duplicate : near_duplicates) {
+        document_ids.push_back(near_duplicate.document_id);
+        if (out != nullptr) {
+            report << "Found near duplicate document id "s << near_duplicate.document_id << " of "s
+                   << near_duplicate.original_id << " (similarity "s << near_duplicate.similarity << ")\n"s;
+        }
+    }
+    if (out != nullptr && stats.truncated_bucket_count > 0) {
+        report << "Not all candidates compared in "s << stats.truncated_bucket_count << " oversized buckets\n"s;
+    }
+    if (out != nullptr && report.tellp() > 0) {
+        *out << report.str() << std::flush;
+    }
+    search_server.RemoveDocuments(document_ids);
+    return near_duplicates;
+}
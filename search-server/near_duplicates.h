@@ -0,0 +1,54 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct NearDuplicateOptions {
+    // Документы с коэффициентом Жаккара наборов слов не ниже порога считаются почти дубликатами
+    double similarity_threshold = 0.8;
+
+    // Подпись MinHash из band_count * rows_per_band значений; документы становятся
+    // кандидатами, если совпадает хотя бы одна полоса из rows_per_band значений
+    size_t band_count = 20;
+
+    size_t rows_per_band = 5;
+
+    // Сколько предшествующих документов корзины сравнивается с каждым документом;
+    // ограничивает работу на больших корзинах. Полнота при этом не гарантируется: документ,
+    // чей оригинал в корзине дальше этого окна (например, в группе из более чем
+    // max_bucket_comparisons + 1 одинаковых документов), найден не будет, если их не сведёт
+    // другая полоса. Такие корзины подсчитываются в NearDuplicateStats::truncated_bucket_count
+    size_t max_bucket_comparisons = 32;
+
+    uint64_t seed = 0x5eed;
+};
+
+struct NearDuplicateStats {
+    // Различных пар документов, сходство которых проверялось точно
+    size_t candidate_count = 0;
+
+    // Корзин (по всем полосам), в которых часть пар не сравнивалась из-за max_bucket_comparisons
+    size_t truncated_bucket_count = 0;
+};
+
+struct NearDuplicate {
+    int document_id;
+
+    // Оставляемый документ с меньшим id, на который похож document_id
+    int original_id;
+
+    double similarity;
+};
+
+// Находит документы, почти совпадающие с каким-либо оставляемым документом с меньшим id.
+// Кандидаты отбираются по LSH, сходство проверяется точно. Результат упорядочен по document_id
+std::vector<NearDuplicate> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options = {},
+                                              NearDuplicateStats* stats = nullptr);
+
+// Удаляет найденные почти дубликаты; если out не nullptr, выводит отчёт одной записью,
+// в том числе число корзин, проверенных не полностью
+std::vector<NearDuplicate> RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options = {},
+                                                std::ostream* out = nullptr);
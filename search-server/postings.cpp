@@ -0,0 +1,286 @@
+#include "postings.h"
+
+namespace {
+
+bool LessDocumentId(const Posting& posting, int document_id) {
+    return posting.document_id < document_id;
+}
+
+void WriteVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t*& in) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        value |= static_cast<uint32_t>(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint32_t>(*in++) << shift;
+    return value;
+}
+
+}
+
+PostingList::PostingList(PostingsFormat format) : format_(format) {}
+
+PostingsFormat PostingList::GetFormat() const {
+    return format_;
+}
+
+void PostingList::SetFormat(PostingsFormat format) {
+    if (format == format_) {
+        return;
+    }
+    if (format == PostingsFormat::COMPRESSED) {
+        Encode(postings_);
+        std::vector<Posting>().swap(postings_);
+    } else {
+        postings_ = Decode();
+        std::vector<Block>().swap(blocks_);
+        std::vector<uint8_t>().swap(data_);
+    }
+    format_ = format;
+}
+
+void PostingList::Insert(int document_id, int term_count) {
+    if (format_ == PostingsFormat::PLAIN) {
+        if (postings_.empty() || postings_.back().document_id < document_id) {
+            postings_.push_back({document_id, term_count});
+            ++size_;
+            return;
+        }
+        auto it = std::lower_bound(postings_.begin(), postings_.end(), document_id, LessDocumentId);
+        if (it != postings_.end() && it->document_id == document_id) {
+            it->term_count = term_count;
+        } else {
+            postings_.insert(it, {document_id, term_count});
+            ++size_;
+        }
+        return;
+    }
+    if (blocks_.empty() || blocks_.back().last_document_id < document_id) {
+        if (blocks_.empty() || blocks_.back().size == BLOCK_SIZE) {
+            blocks_.push_back({document_id, document_id, static_cast<uint32_t>(data_.size()), 1});
+            WriteVarint(data_, static_cast<uint32_t>(term_count));
+        } else {
+            Block& block = blocks_.back();
+            WriteVarint(data_, static_cast<uint32_t>(document_id - block.last_document_id));
+            WriteVarint(data_, static_cast<uint32_t>(term_count));
+            block.last_document_id = document_id;
+            ++block.size;
+        }
+        ++size_;
+        return;
+    }
+    const size_t block_index = FindBlock(document_id);
+    std::vector<Posting> postings(blocks_[block_index].size);
+    DecodeBlock(block_index, postings.data());
+    auto it = std::lower_bound(postings.begin(), postings.end(), document_id, LessDocumentId);
+    if (it != postings.end() && it->document_id == document_id) {
+        it->term_count = term_count;
+    } else {
+        postings.insert(it, {document_id, term_count});
+        ++size_;
+    }
+    RewriteBlock(block_index, postings);
+}
+
+bool PostingList::Erase(int document_id) {
+    if (format_ == PostingsFormat::PLAIN) {
+        auto it = std::lower_bound(postings_.begin(), postings_.end(), document_id, LessDocumentId);
+        if (it == postings_.end() || it->document_id != document_id) {
+            return false;
+        }
+        postings_.erase(it);
+        --size_;
+        return true;
+    }
+    const size_t block_index = FindBlock(document_id);
+    if (block_index == blocks_.size() || blocks_[block_index].first_document_id > document_id) {
+        return false;
+    }
+    std::vector<Posting> postings(blocks_[block_index].size);
+    DecodeBlock(block_index, postings.data());
+    auto it = std::lower_bound(postings.begin(), postings.end(), document_id, LessDocumentId);
+    if (it == postings.end() || it->document_id != document_id) {
+        return false;
+    }
+    postings.erase(it);
+    --size_;
+    RewriteBlock(block_index, postings);
+    return true;
+}
+
+void PostingList::Remap(const std::vector<int>& new_document_ids) {
+    std::vector<Posting> postings = Decode();
+    size_t count = 0;
+    for (const Posting& posting : postings) {
+        const int document_id = new_document_ids[posting.document_id];
+        if (document_id >= 0) {
+            postings[count++] = {document_id, posting.term_count};
+        }
+    }
+    postings.resize(count);
+    if (format_ == PostingsFormat::PLAIN) {
+        postings.shrink_to_fit();
+        postings_.swap(postings);
+        size_ = postings_.size();
+    } else {
+        Encode(postings);
+    }
+}
+
+bool PostingList::Contains(int document_id) const {
+    if (format_ == PostingsFormat::PLAIN) {
+        auto it = std::lower_bound(postings_.begin(), postings_.end(), document_id, LessDocumentId);
+        return it != postings_.end() && it->document_id == document_id;
+    }
+    const size_t block_index = FindBlock(document_id);
+    if (block_index == blocks_.size() || blocks_[block_index].first_document_id > document_id) {
+        return false;
+    }
+    Posting buffer[BLOCK_SIZE];
+    const size_t count = DecodeBlock(block_index, buffer);
+    return std::binary_search(buffer, buffer + count, Posting{document_id, 0},
+                              [](const Posting& lhs, const Posting& rhs) {
+                                  return lhs.document_id < rhs.document_id;
+                              });
+}
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+size_t PostingList::GetMemoryUsage() const {
+    return sizeof(PostingList)
+           + postings_.capacity() * sizeof(Posting)
+           + blocks_.capacity() * sizeof(Block)
+           + data_.capacity() * sizeof(uint8_t);
+}
+
+std::vector<Posting> PostingList::Decode() const {
+    if (format_ == PostingsFormat::PLAIN) {
+        return postings_;
+    }
+    std::vector<Posting> postings(size_);
+    size_t pos = 0;
+    for (size_t block_index = 0; block_index < blocks_.size(); ++block_index) {
+        pos += DecodeBlock(block_index, postings.data() + pos);
+    }
+    return postings;
+}
+
+size_t PostingList::DecodeBlock(size_t block_index, Posting* out) const {
+    const Block& block = blocks_[block_index];
+    const uint8_t* in = data_.data() + block.offset;
+    int document_id = block.first_document_id;
+    out[0] = {document_id, static_cast<int>(ReadVarint(in))};
+    for (uint32_t i = 1; i < block.size; ++i) {
+        document_id += static_cast<int>(ReadVarint(in));
+        out[i] = {document_id, static_cast<int>(ReadVarint(in))};
+    }
+    return block.size;
+}
+
+size_t PostingList::FindBlock(int document_id) const {
+    auto it = std::lower_bound(blocks_.begin(), blocks_.end(), document_id,
+                               [](const Block& block, int document_id) {
+                                   return block.last_document_id < document_id;
+                               });
+    return it - blocks_.begin();
+}
+
+void PostingList::RewriteBlock(size_t block_index, const std::vector<Posting>& postings) {
+    PostingList encoded(PostingsFormat::COMPRESSED);
+    encoded.Encode(postings);
+    const Block& old_block = blocks_[block_index];
+    const size_t old_begin = old_block.offset;
+    const size_t old_end = block_index + 1 < blocks_.size() ? blocks_[block_index + 1].offset : data_.size();
+    const auto shift = static_cast<int64_t>(encoded.data_.size()) - static_cast<int64_t>(old_end - old_begin);
+    for (Block& block : encoded.blocks_) {
+        block.offset += static_cast<uint32_t>(old_begin);
+    }
+    data_.erase(data_.begin() + old_begin, data_.begin() + old_end);
+    data_.insert(data_.begin() + old_begin, encoded.data_.begin(), encoded.data_.end());
+    for (size_t i = block_index + 1; i < blocks_.size(); ++i) {
+        blocks_[i].offset = static_cast<uint32_t>(blocks_[i].offset + shift);
+    }
+    blocks_.erase(blocks_.begin() + block_index);
+    blocks_.insert(blocks_.begin() + block_index, encoded.blocks_.begin(), encoded.blocks_.end());
+}
+
+void PostingList::Encode(const std::vector<Posting>& postings) {
+    blocks_.clear();
+    data_.clear();
+    const size_t block_count = (postings.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (size_t block_index = 0; block_index < block_count; ++block_index) {
+        const size_t begin = postings.size() * block_index / block_count;
+        const size_t end = postings.size() * (block_index + 1) / block_count;
+        blocks_.push_back({postings[begin].document_id, postings[end - 1].document_id,
+                           static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(end - begin)});
+        WriteVarint(data_, static_cast<uint32_t>(postings[begin].term_count));
+        for (size_t i = begin + 1; i < end; ++i) {
+            WriteVarint(data_, static_cast<uint32_t>(postings[i].document_id - postings[i - 1].document_id));
+            WriteVarint(data_, static_cast<uint32_t>(postings[i].term_count));
+        }
+    }
+    blocks_.shrink_to_fit();
+    data_.shrink_to_fit();
+    size_ = postings.size();
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings) : postings_(&postings) {
+    if (postings_->format_ == PostingsFormat::COMPRESSED) {
+        buffer_.resize(BLOCK_SIZE);
+        LoadBlock(0);
+    }
+}
+
+void PostingList::Cursor::SeekTo(int target) {
+    if (AtEnd() || GetDocumentId() >= target) {
+        return;
+    }
+    if (postings_->format_ == PostingsFormat::PLAIN) {
+        const auto& postings = postings_->postings_;
+        // Экспоненциальный поиск от текущей позиции: цели запросов обычно недалеко
+        size_t step = 1;
+        size_t low = position_;
+        size_t high = position_ + 1;
+        while (high < postings.size() && postings[high].document_id < target) {
+            low = high;
+            step *= 2;
+            high = position_ + step;
+        }
+        high = std::min(high, postings.size());
+        position_ = std::lower_bound(postings.begin() + low, postings.begin() + high, target, LessDocumentId) - postings.begin();
+        return;
+    }
+    const auto& blocks = postings_->blocks_;
+    if (blocks[block_index_].last_document_id < target) {
+        const auto it = std::lower_bound(blocks.begin() + block_index_ + 1, blocks.end(), target,
+                                         [](const Block& block, int document_id) {
+                                             return block.last_document_id < document_id;
+                                         });
+        LoadBlock(it - blocks.begin());
+        if (AtEnd()) {
+            return;
+        }
+    }
+    position_ = std::lower_bound(buffer_.begin() + position_, buffer_.begin() + block_size_, target, LessDocumentId) - buffer_.begin();
+}
+
+void PostingList::Cursor::LoadBlock(size_t block_index) {
+    block_index_ = block_index;
+    position_ = 0;
+    block_size_ = block_index_ < postings_->blocks_.size() ? postings_->DecodeBlock(block_index_, buffer_.data()) : 0;
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Posting {
+    int document_id;
+    int term_count;
+};
+
+enum class PostingsFormat {
+    PLAIN,
+    COMPRESSED,
+};
+
+// Список вхождений одного слова, отсортированный по document_id.
+// В формате PLAIN хранится непрерывным массивом Posting, в формате COMPRESSED —
+// блоками по BLOCK_SIZE вхождений: разности document_id и количества вхождений
+// слова кодируются variable-byte, а для каждого блока хранится запись таблицы пропусков
+class PostingList {
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    explicit PostingList(PostingsFormat format = PostingsFormat::PLAIN);
+
+    PostingsFormat GetFormat() const;
+
+    void SetFormat(PostingsFormat format);
+
+    void Insert(int document_id, int term_count);
+
+    bool Erase(int document_id);
+
+    // Заменяет document_id на new_document_ids[document_id], отбрасывая вхождения с -1.
+    // Отображение должно сохранять порядок
+    void Remap(const std::vector<int>& new_document_ids);
+
+    bool Contains(int document_id) const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    size_t GetMemoryUsage() const;
+
+    std::vector<Posting> Decode() const;
+
+    template <typename Visitor>
+    void ForEach(Visitor visitor) const;
+
+    // Обходит только вхождения с first <= document_id < last
+    template <typename Visitor>
+    void ForEachInRange(int first, int last, Visitor visitor) const;
+
+    // Курсор для обхода списка по одному документу: позволяет перескакивать к заданному
+    // document_id, а в формате COMPRESSED — пропускать блоки без их декодирования
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool AtEnd() const;
+
+        int GetDocumentId() const;
+
+        int GetTermCount() const;
+
+        void Next();
+
+        // Переходит к первому вхождению с document_id >= target
+        void SeekTo(int target);
+
+        // Обходит вхождения от текущего до первого с document_id >= last и останавливается на нём
+        template <typename Visitor>
+        void ForEachBefore(int last, Visitor visitor);
+
+    private:
+        const PostingList* postings_;
+
+        size_t position_ = 0;
+
+        size_t block_index_ = 0;
+
+        size_t block_size_ = 0;
+
+        std::vector<Posting> buffer_;
+
+        void LoadBlock(size_t block_index);
+    };
+
+private:
+    struct Block {
+        int first_document_id;
+        int last_document_id;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    PostingsFormat format_;
+
+    size_t size_ = 0;
+
+    std::vector<Posting> postings_;
+
+    std::vector<Block> blocks_;
+
+    std::vector<uint8_t> data_;
+
+    size_t DecodeBlock(size_t block_index, Posting* out) const;
+
+    size_t FindBlock(int document_id) const;
+
+    void RewriteBlock(size_t block_index, const std::vector<Posting>& postings);
+
+    void Encode(const std::vector<Posting>& postings);
+};
+
+// Вызываются на каждое вхождение при обходе курсором, поэтому определены в заголовке
+inline bool PostingList::Cursor::AtEnd() const {
+    if (postings_->format_ == PostingsFormat::PLAIN) {
+        return position_ >= postings_->postings_.size();
+    }
+    return block_index_ >= postings_->blocks_.size();
+}
+
+inline int PostingList::Cursor::GetDocumentId() const {
+    if (postings_->format_ == PostingsFormat::PLAIN) {
+        return postings_->postings_[position_].document_id;
+    }
+    return buffer_[position_].document_id;
+}
+
+inline int PostingList::Cursor::GetTermCount() const {
+    if (postings_->format_ == PostingsFormat::PLAIN) {
+        return postings_->postings_[position_].term_count;
+    }
+    return buffer_[position_].term_count;
+}
+
+inline void PostingList::Cursor::Next() {
+    ++position_;
+    if (postings_->format_ == PostingsFormat::COMPRESSED && position_ >= block_size_) {
+        LoadBlock(block_index_ + 1);
+    }
+}
+
+template <typename Visitor>
+void PostingList::Cursor::ForEachBefore(int last, Visitor visitor) {
+    if (postings_->format_ == PostingsFormat::PLAIN) {
+        const std::vector<Posting>& postings = postings_->postings_;
+        size_t position = position_;
+        for (; position < postings.size() && postings[position].document_id < last; ++position) {
+            visitor(postings[position].document_id, postings[position].term_count);
+        }
+        position_ = position;
+        return;
+    }
+    while (!AtEnd()) {
+        const Posting* buffer = buffer_.data();
+        size_t position = position_;
+        for (; position < block_size_ && buffer[position].document_id < last; ++position) {
+            visitor(buffer[position].document_id, buffer[position].term_count);
+        }
+        position_ = position;
+        if (position_ < block_size_) {
+            return;
+        }
+        LoadBlock(block_index_ + 1);
+    }
+}
+
+template <typename Visitor>
+void PostingList::ForEach(Visitor visitor) const {
+    if (format_ == PostingsFormat::PLAIN) {
+        for (const Posting& posting : postings_) {
+            visitor(posting.document_id, posting.term_count);
+        }
+        return;
+    }
+    Posting buffer[BLOCK_SIZE];
+    for (size_t block_index = 0; block_index < blocks_.size(); ++block_index) {
+        const size_t count = DecodeBlock(block_index, buffer);
+        for (size_t i = 0; i < count; ++i) {
+            visitor(buffer[i].document_id, buffer[i].term_count);
+        }
+    }
+}
+
+template <typename Visitor>
+void PostingList::ForEachInRange(int first, int last, Visitor visitor) const {
+    if (format_ == PostingsFormat::PLAIN) {
+        auto it = std::lower_bound(postings_.begin(), postings_.end(), first,
+                                   [](const Posting& posting, int document_id) {
+                                       return posting.document_id < document_id;
+                                   });
+        for (; it != postings_.end() && it->document_id < last; ++it) {
+            visitor(it->document_id, it->term_count);
+        }
+        return;
+    }
+    Posting buffer[BLOCK_SIZE];
+    for (size_t block_index = FindBlock(first);
+         block_index < blocks_.size() && blocks_[block_index].first_document_id < last; ++block_index) {
+        const size_t count = DecodeBlock(block_index, buffer);
+        for (size_t i = 0; i < count; ++i) {
+            if (buffer[i].document_id >= first && buffer[i].document_id < last) {
+                visitor(buffer[i].document_id, buffer[i].term_count);
+            }
+        }
+    }
+}
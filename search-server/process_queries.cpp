@@ -1,24 +1,33 @@
 #include "process_queries.h"
 
+#include <numeric>
+
+BatchResults ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries) {
+    BatchResults results(queries.size(), MAX_RESULT_DOCUMENT_COUNT);
+    std::vector<size_t> query_indexes(queries.size());
+    std::iota(query_indexes.begin(), query_indexes.end(), 0);
+    std::for_each(std::execution::par,
+                  query_indexes.begin(), query_indexes.end(),
+                  [&](size_t query_index) {
+                      thread_local SearchServer::Scratch scratch;
+                      results.SetCount(query_index, search_server.FindTopDocuments(
+                              scratch, queries[query_index], DocumentStatus::ACTUAL, MAX_RESULT_DOCUMENT_COUNT,
+                              results.GetSlot(query_index)));
+                  });
+    results.Seal();
+    return results;
+}
+
 std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries) {
-    std::vector<std::vector<Document>> docs(queries.size());
-    std::transform(std::execution::par,
-                   queries.begin(), queries.end(),
-                   docs.begin(),
-                   [&search_server](const std::string& query) {
-                       return search_server.FindTopDocuments(query);
-                   });
-    return docs;
+    return ProcessQueriesFlat(search_server, queries).ToNested();
 }
 
 std::vector<Document> ProcessQueriesJoined(
         const SearchServer& search_server,
         const std::vector<std::string>& queries) {
-    std::vector<Document> docs;
-    for(const auto& vec_docs : ProcessQueries(search_server, queries)) {
-        docs.insert(docs.end(), vec_docs.begin(), vec_docs.end());
-    }
-    return docs;
-}
\ No newline at end of file
+    return ProcessQueriesFlat(search_server, queries).ReleaseDocuments();
+}
@@ -2,11 +2,17 @@
 
 #include "document.h"
 #include "search_server.h"
+#include "batch_results.h"
 
 #include <vector>
 #include <execution>
 #include <algorithm>
 
+// Результаты всех запросов в одном буфере; ProcessQueries и ProcessQueriesJoined — его представления
+BatchResults ProcessQueriesFlat(
+        const SearchServer& search_server,
+        const std::vector<std::string>& queries);
+
 std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries);
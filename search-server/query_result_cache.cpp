@@ -0,0 +1,52 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(size_t byte_budget) : byte_budget_(byte_budget) {}
+
+std::optional<std::vector<Document>> QueryResultCache::Find(const std::string& key, uint64_t index_version) {
+    const auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        return std::nullopt;
+    }
+    if (it->second->index_version != index_version) {
+        Erase(it->second);
+        ++misses_;
+        return std::nullopt;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    ++hits_;
+    return it->second->documents;
+}
+
+void QueryResultCache::Insert(const std::string& key, uint64_t index_version, const std::vector<Document>& documents) {
+    const size_t entry_bytes = GetEntryBytes(key, documents);
+    if (entry_bytes > byte_budget_) {
+        return;
+    }
+    const auto it = index_.find(key);
+    if (it != index_.end()) {
+        Erase(it->second);
+    }
+    while (used_bytes_ + entry_bytes > byte_budget_) {
+        Erase(std::prev(entries_.end()));
+    }
+    entries_.push_front({key, index_version, documents});
+    index_.emplace(key, entries_.begin());
+    used_bytes_ += entry_bytes;
+}
+
+QueryCacheStats QueryResultCache::GetStats() const {
+    return {hits_, misses_, used_bytes_};
+}
+
+size_t QueryResultCache::GetEntryBytes(const std::string& key, const std::vector<Document>& documents) {
+    // Ключ хранится дважды: в записи списка и в хеш-таблице
+    return sizeof(Entry) + 2 * key.size() + documents.size() * sizeof(Document)
+           + sizeof(std::pair<const std::string, std::list<Entry>::iterator>);
+}
+
+void QueryResultCache::Erase(std::list<Entry>::iterator it) {
+    used_bytes_ -= GetEntryBytes(it->key, it->documents);
+    index_.erase(it->key);
+    entries_.erase(it);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t used_bytes = 0;
+};
+
+// LRU-кэш результатов запросов с ограничением по занимаемой памяти. Запись хранит
+// версию индекса, для которой получен результат, и при другой версии считается устаревшей
+class QueryResultCache {
+public:
+    explicit QueryResultCache(size_t byte_budget);
+
+    std::optional<std::vector<Document>> Find(const std::string& key, uint64_t index_version);
+
+    void Insert(const std::string& key, uint64_t index_version, const std::vector<Document>& documents);
+
+    QueryCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t index_version;
+        std::vector<Document> documents;
+    };
+
+    size_t byte_budget_;
+
+    size_t used_bytes_ = 0;
+
+    uint64_t hits_ = 0;
+
+    uint64_t misses_ = 0;
+
+    // В начале списка — недавно использованные записи
+    std::list<Entry> entries_;
+
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+    static size_t GetEntryBytes(const std::string& key, const std::vector<Document>& documents);
+
+    void Erase(std::list<Entry>::iterator it);
+};
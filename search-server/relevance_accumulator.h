@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Плотный накопитель релевантности для диапазона порядковых номеров документов
+// [first, first + size). Рассчитан на многократное использование одним потоком:
+// после ForEachMatched сбрасываются только затронутые позиции
+class RelevanceAccumulator {
+public:
+    // Отбрасывает значения, оставшиеся от подсчёта, прерванного исключением
+    void Reset(int first, int size) {
+        Clear();
+        first_ = first;
+        size_ = size;
+        if (relevances_.size() < static_cast<size_t>(size)) {
+            relevances_.assign(size, 0.0);
+            matched_.assign((size + WORD_BITS - 1) / WORD_BITS, 0);
+        }
+    }
+
+    void Add(int ordinal, double relevance) {
+        const int index = ordinal - first_;
+        uint64_t& word = matched_[index / WORD_BITS];
+        const uint64_t bit = uint64_t{1} << (index % WORD_BITS);
+        if (!(word & bit)) {
+            word |= bit;
+            touched_ordinals_.push_back(ordinal);
+        }
+        relevances_[index] += relevance;
+    }
+
+    // Обходит документы по возрастанию порядкового номера: отбор лучших документов сравнивает
+    // релевантность с точностью до EPSILON, это сравнение нетранзитивно, и результат отбора
+    // зависит от порядка добавления. Немногие затронутые номера сортируются, а при большом
+    // их числе дешевле пройти весь диапазон
+    template <typename Function>
+    void ForEachMatched(Function function) {
+        if (touched_ordinals_.size() * DENSE_WALK_RATIO < static_cast<size_t>(size_)) {
+            std::sort(touched_ordinals_.begin(), touched_ordinals_.end());
+            for (const int ordinal : touched_ordinals_) {
+                Visit(ordinal - first_, function);
+            }
+        } else {
+            const int word_count = (size_ + WORD_BITS - 1) / WORD_BITS;
+            for (int word = 0; word < word_count; ++word) {
+                for (uint64_t bits = matched_[word]; bits != 0; bits &= bits - 1) {
+                    Visit(word * WORD_BITS + __builtin_ctzll(bits), function);
+                }
+            }
+        }
+        touched_ordinals_.clear();
+    }
+
+    void Clear() {
+        for (const int ordinal : touched_ordinals_) {
+            const int index = ordinal - first_;
+            matched_[index / WORD_BITS] = 0;
+            relevances_[index] = 0.0;
+        }
+        touched_ordinals_.clear();
+    }
+
+private:
+    // Сортировка выгоднее обхода диапазона, пока затронуто меньше 1/DENSE_WALK_RATIO его номеров
+    static constexpr size_t DENSE_WALK_RATIO = 64;
+
+    static const int WORD_BITS = 64;
+
+    int first_ = 0;
+
+    int size_ = 0;
+
+    std::vector<double> relevances_;
+
+    // Битовое множество затронутых позиций
+    std::vector<uint64_t> matched_;
+
+    std::vector<int> touched_ordinals_;
+
+    template <typename Function>
+    void Visit(int index, Function& function) {
+        function(first_ + index, relevances_[index]);
+        matched_[index / WORD_BITS] = 0;
+        relevances_[index] = 0.0;
+    }
+};
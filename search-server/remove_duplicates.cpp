@@ -1,31 +1,110 @@
 #include "remove_duplicates.h"
+#include "hash_utils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <sstream>
 
 using namespace std::string_literals;
 
-void RemoveDuplicates(SearchServer& search_server) {
-    std::map<std::set<std::string_view>, int> unique_documents;
-    std::vector<int> duplicates;
-    for (int doc_id : search_server) {
-        const auto& doc_words = search_server.GetWordFrequencies(doc_id);
-        std::set<std::string_view> unique_words;
-        for (const auto& [word, _] : doc_words) {
-                unique_words.insert(word);
+namespace {
+
+struct Fingerprint {
+    uint64_t low;
+    uint64_t high;
+
+    bool operator<(const Fingerprint& other) const {
+        return std::tie(low, high) < std::tie(other.low, other.high);
+    }
+
+    bool operator==(const Fingerprint& other) const {
+        return low == other.low && high == other.high;
+    }
+};
+
+// Два независимых 64-битных хеша по словам в порядке возрастания (так упорядочены ключи
+// GetWordFrequencies); вместе с числом слов совпадение случайно практически исключено
+Fingerprint ComputeFingerprint(const std::map<std::string_view, double>& word_freqs) {
+    Fingerprint fingerprint{word_freqs.size(), ~uint64_t{word_freqs.size()}};
+    for (const auto& [word, term_freq] : word_freqs) {
+        const uint64_t word_hash = std::hash<std::string_view>{}(word);
+        fingerprint.low = Mix(fingerprint.low ^ word_hash) + 0x9e3779b97f4a7c15ULL;
+        fingerprint.high = Mix(fingerprint.high + word_hash * 0x2545f4914f6cdd1dULL) ^ (fingerprint.high << 7);
+    }
+    return fingerprint;
+}
+
+bool HaveSameWords(const std::map<std::string_view, double>& lhs, const std::map<std::string_view, double>& rhs) {
+    return lhs.size() == rhs.size()
+           && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const auto& lhs_word, const auto& rhs_word) {
+               return lhs_word.first == rhs_word.first;
+           });
+}
+
+}
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server, std::ostream* out) {
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<const std::map<std::string_view, double>*> word_freqs(document_ids.size());
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), word_freqs.begin(),
+                   [&search_server](int document_id) {
+                       return &search_server.GetWordFrequencies(document_id);
+                   });
+    std::vector<std::pair<Fingerprint, size_t>> fingerprints(document_ids.size());
+    std::vector<size_t> indexes(document_ids.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::transform(std::execution::par, indexes.begin(), indexes.end(), fingerprints.begin(), [&word_freqs](size_t index) {
+        return std::pair{ComputeFingerprint(*word_freqs[index]), index};
+    });
+    // Документы с равными отпечатками оказываются рядом и упорядочены по возрастанию id
+    std::sort(std::execution::par, fingerprints.begin(), fingerprints.end());
+
+    std::vector<size_t> group_starts;
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+        if (i == 0 || !(fingerprints[i].first == fingerprints[i - 1].first)) {
+            group_starts.push_back(i);
         }
-        if (!unique_documents.count(unique_words)) {
-            unique_documents[unique_words] = doc_id;
-        } else {
-            int existing_id = unique_documents[unique_words];
-            if (doc_id > existing_id) {
-                duplicates.push_back(doc_id);
-                std::cout << "Found duplicate document id "s << doc_id << std::endl;
+    }
+    std::vector<uint8_t> is_duplicate(document_ids.size(), 0);
+    std::for_each(std::execution::par, group_starts.begin(), group_starts.end(), [&](size_t group_start) {
+        if (group_start + 1 == fingerprints.size() || !(fingerprints[group_start + 1].first == fingerprints[group_start].first)) {
+            return;
+        }
+        // Отпечатки совпали: точная проверка против уже найденных различных наборов группы
+        std::vector<size_t> originals;
+        for (size_t i = group_start; i < fingerprints.size() && fingerprints[i].first == fingerprints[group_start].first; ++i) {
+            const size_t index = fingerprints[i].second;
+            const bool has_original = std::any_of(originals.begin(), originals.end(), [&](size_t original) {
+                return HaveSameWords(*word_freqs[original], *word_freqs[index]);
+            });
+            if (has_original) {
+                is_duplicate[index] = 1;
             } else {
-                duplicates.push_back(existing_id);
-                std::cout << "Found duplicate document id "s << existing_id << std::endl;
-                unique_documents[unique_words] = doc_id;
+                originals.push_back(index);
             }
         }
+    });
+
+    std::vector<int> duplicates;
+    for (size_t index = 0; index < document_ids.size(); ++index) {
+        if (is_duplicate[index]) {
+            duplicates.push_back(document_ids[index]);
+        }
     }
-    for (int doc_id : duplicates) {
-        search_server.RemoveDocument(doc_id);
+    if (out != nullptr && !duplicates.empty()) {
+        std::ostringstream report;
+        for (int document_id : duplicates) {
+            report << "Found duplicate document id "s << document_id << '\n';
+        }
+        *out << report.str() << std::flush;
     }
+    search_server.RemoveDocuments(duplicates);
+    return duplicates;
+}
+
+void RemoveDuplicates(SearchServer& search_server) {
+    RemoveDuplicates(search_server, &std::cout);
 }
@@ -2,6 +2,13 @@
 
 #include "search_server.h"
 
+#include <ostream>
 #include <string_view>
+#include <vector>
+
+// Удаляет документы с тем же набором слов, что и у документа с меньшим id.
+// Возвращает id удалённых документов по возрастанию; если out не nullptr,
+// отчёт собирается в буфер и выводится в out одной записью
+std::vector<int> RemoveDuplicates(SearchServer& search_server, std::ostream* out);
 
 void RemoveDuplicates(SearchServer& search_server);
@@ -1,12 +1,41 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) : search_server_(search_server) {}
+RequestQueue::RequestQueue(const SearchServer& search_server) : RequestQueue(search_server, RequestQueueOptions{}) {}
+
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t cache_byte_budget)
+        : RequestQueue(search_server, RequestQueueOptions{cache_byte_budget, false}) {}
+
+RequestQueue::RequestQueue(const SearchServer& search_server, const RequestQueueOptions& options)
+        : search_server_(search_server) {
+    if (options.cache_byte_budget > 0) {
+        cache_.emplace(options.cache_byte_budget);
+    }
+    if (options.store_requests) {
+        requests_ = std::make_unique<std::string[]>(min_in_day_);
+    }
+}
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return AddFindRequest(
-            raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+    if (!cache_) {
+        const std::vector<Document> matched_documents = search_server_.FindTopDocuments(raw_query, status);
+        AddRequestResult(raw_query, matched_documents.empty());
+        return matched_documents;
+    }
+    const std::string key = search_server_.NormalizeQuery(raw_query) + '\0' + std::to_string(static_cast<int>(status));
+    const uint64_t index_version = search_server_.GetIndexVersion();
+    std::optional<std::vector<Document>> matched_documents;
+    {
+        std::lock_guard guard(cache_mutex_);
+        matched_documents = cache_->Find(key, index_version);
+    }
+    if (!matched_documents) {
+        // Поиск выполняется без блокировки кэша
+        matched_documents = search_server_.FindTopDocuments(raw_query, status);
+        std::lock_guard guard(cache_mutex_);
+        cache_->Insert(key, index_version, *matched_documents);
+    }
+    AddRequestResult(raw_query, matched_documents->empty());
+    return *matched_documents;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
@@ -14,5 +43,38 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return count_if(requests_.begin(), requests_.end(),[](const QueryResult& req){return req.isEmptyRequest;});
-}
\ No newline at end of file
+    return no_result_count_.load();
+}
+
+QueryCacheStats RequestQueue::GetCacheStats() const {
+    std::lock_guard guard(cache_mutex_);
+    return cache_ ? cache_->GetStats() : QueryCacheStats{};
+}
+
+std::vector<std::string> RequestQueue::GetRequests() const {
+    std::vector<std::string> requests;
+    if (!requests_) {
+        return requests;
+    }
+    const uint64_t request_count = request_count_.load();
+    const uint64_t window = std::min<uint64_t>(request_count, min_in_day_);
+    requests.reserve(window);
+    for (uint64_t number = request_count; number > request_count - window; --number) {
+        const size_t slot = (number - 1) % min_in_day_;
+        std::lock_guard guard(request_mutexes_[slot % REQUEST_LOCK_COUNT]);
+        requests.push_back(requests_[slot]);
+    }
+    return requests;
+}
+
+void RequestQueue::AddRequestResult(const std::string& raw_query, bool is_empty) {
+    const size_t slot = request_count_.fetch_add(1) % min_in_day_;
+    // Вытесняемый запрос того же слота учитывается обменом, поэтому счётчик
+    // согласован с содержимым буфера и при одновременной записи
+    const uint8_t evicted = is_empty_results_[slot].exchange(is_empty ? 1 : 0);
+    no_result_count_ += static_cast<int>(is_empty) - static_cast<int>(evicted);
+    if (requests_) {
+        std::lock_guard guard(request_mutexes_[slot % REQUEST_LOCK_COUNT]);
+        requests_[slot] = raw_query;
+    }
+}
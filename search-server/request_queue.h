@@ -2,14 +2,38 @@
 
 #include "document.h"
 #include "search_server.h"
+#include "query_result_cache.h"
 
 #include <algorithm>
-#include <deque>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 
+struct RequestQueueOptions {
+    // 0 отключает кэш результатов
+    size_t cache_byte_budget = 0;
+
+    // Хранить ли тексты запросов для GetRequests
+    bool store_requests = false;
+};
+
+// Учитывает запросы за последние сутки (по запросу в минуту). Запросы можно
+// добавлять одновременно из нескольких потоков
 class RequestQueue {
 public:
     explicit RequestQueue(const SearchServer& search_server);
 
+    // Запросы по статусу кэшируются в пределах cache_byte_budget байт;
+    // запросы с предикатом всегда выполняются поисковым сервером
+    RequestQueue(const SearchServer& search_server, size_t cache_byte_budget);
+
+    RequestQueue(const SearchServer& search_server, const RequestQueueOptions& options);
+
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 
@@ -19,28 +43,41 @@ public:
 
     int GetNoResultRequests() const;
 
-private:
-    struct QueryResult {
-        std::string request;
-        bool isEmptyRequest;
-    };
+    QueryCacheStats GetCacheStats() const;
 
-    std::deque<QueryResult> requests_;
+    // Тексты запросов за последние сутки от новых к старым; пусто, если store_requests не задан
+    std::vector<std::string> GetRequests() const;
 
+private:
     const static int min_in_day_ = 1440;
 
-    int seconds_ = 0;
+    static const size_t REQUEST_LOCK_COUNT = 16;
+
+    // Кольцевой буфер: запрос с номером n записывается в ячейку n % min_in_day_,
+    // ячейка хранит признак пустого результата
+    std::array<std::atomic<uint8_t>, min_in_day_> is_empty_results_{};
+
+    std::atomic<uint64_t> request_count_{0};
+
+    std::atomic<int> no_result_count_{0};
 
     const SearchServer& search_server_ ;
+
+    std::optional<QueryResultCache> cache_;
+
+    mutable std::mutex cache_mutex_;
+
+    std::unique_ptr<std::string[]> requests_;
+
+    // Ячейки текстов запросов защищены мьютексами по остатку от номера ячейки
+    mutable std::array<std::mutex, REQUEST_LOCK_COUNT> request_mutexes_;
+
+    void AddRequestResult(const std::string& raw_query, bool is_empty);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
     const std::vector<Document> matched_documents = search_server_.FindTopDocuments(raw_query, document_predicate);
-    requests_.push_front({raw_query, matched_documents.empty()});
-    ++seconds_;
-    if(seconds_ > min_in_day_) {
-        requests_.pop_back();
-    }
+    AddRequestResult(raw_query, matched_documents.empty());
     return matched_documents;
-}
\ No newline at end of file
+}
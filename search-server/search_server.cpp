@@ -10,32 +10,284 @@ SearchServer::SearchServer(std::string_view stop_words_text)
         SplitIntoWords(stop_words_text)) {}
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || documents_.Contains(document_id)) {
         throw std::invalid_argument("Invalid document_id"s);
     }
-    words_.emplace_back(document);
-    const auto words = SplitIntoWordsNoStop(words_.back());
+    thread_local std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
     const double inv_word_count = 1.0 / words.size();
+    std::map<std::string_view, int> word_counts;
     for (std::string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        word_freq_[document_id][word] += inv_word_count;
+        ++word_counts[word];
+    }
+    const int ordinal = documents_.Add(document_id, ComputeAverageRating(ratings), status, inv_word_count);
+    auto& word_freqs = word_freq_[document_id];
+    for (const auto [word, term_count] : word_counts) {
+        const int term_id = GetOrAddTermId(word);
+        word_freqs.emplace_hint(word_freqs.end(), term_words_[term_id], term_count * inv_word_count);
+        AddPosting(term_id, ordinal, term_count);
+        UpdateWordDocumentFreq(term_id);
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
     document_ids_.insert(document_id);
+    UpdateDocumentCount();
+    ++index_version_;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+void SearchServer::AddDocumentsFrom(const std::vector<const SearchServer*>& sources) {
+    std::unordered_set<int> batch_ids;
+    for (const SearchServer* source : sources) {
+        for (const int document_id : source->document_ids_) {
+            if (documents_.Contains(document_id) || !batch_ids.insert(document_id).second) {
+                throw std::invalid_argument("Invalid document_id"s);
+            }
+        }
+    }
+    // Документы получают номера подряд, поэтому вхождения дописываются в конец списков
+    std::vector<int> touched_term_ids;
+    std::vector<bool> is_touched;
+    for (const SearchServer* source : sources) {
+        for (const int document_id : source->document_ids_) {
+            const int source_ordinal = source->documents_.GetOrdinal(document_id);
+            const double inv_word_count = source->documents_.GetInvWordCount(source_ordinal);
+            const int ordinal = documents_.Add(document_id, source->documents_.GetRating(source_ordinal),
+                                               source->documents_.GetStatus(source_ordinal), inv_word_count);
+            auto& word_freqs = word_freq_[document_id];
+            for (const auto [word, term_freq] : source->word_freq_.at(document_id)) {
+                const int term_id = GetOrAddTermId(word);
+                if (static_cast<size_t>(term_id) >= is_touched.size()) {
+                    is_touched.resize(word_to_document_freqs_.size());
+                }
+                if (!is_touched[term_id]) {
+                    is_touched[term_id] = true;
+                    touched_term_ids.push_back(term_id);
+                }
+                word_freqs.emplace_hint(word_freqs.end(), term_words_[term_id], term_freq);
+                AddPosting(term_id, ordinal, static_cast<int>(std::llround(term_freq / inv_word_count)));
+            }
+            document_ids_.insert(document_id);
+        }
+    }
+    std::for_each(std::execution::par, touched_term_ids.begin(), touched_term_ids.end(), [this](int term_id) {
+        UpdateWordDocumentFreq(term_id);
     });
+    UpdateDocumentCount();
+    ++index_version_;
+}
+
+void SearchServer::UpdateDocumentStatus(int document_id, DocumentStatus status) {
+    const int ordinal = documents_.GetOrdinal(document_id);
+    if (documents_.GetStatus(ordinal) != status) {
+        documents_.SetStatus(ordinal, status);
+        ++index_version_;
+    }
+}
+
+void SearchServer::UpdateDocumentRating(int document_id, const std::vector<int>& ratings) {
+    const int ordinal = documents_.GetOrdinal(document_id);
+    documents_.SetRating(ordinal, ComputeAverageRating(ratings));
+    ++index_version_;
+}
+
+void SearchServer::UpdateDocument(int document_id, std::string_view document) {
+    const int ordinal = documents_.GetOrdinal(document_id);
+    thread_local std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
+    const double inv_word_count = 1.0 / words.size();
+    std::map<std::string_view, int> word_counts;
+    for (std::string_view word : words) {
+        ++word_counts[word];
+    }
+    const double old_inv_word_count = documents_.GetInvWordCount(ordinal);
+    documents_.SetInvWordCount(ordinal, inv_word_count);
+    auto& word_freqs = word_freq_.at(document_id);
+    std::map<std::string_view, double> new_word_freqs;
+    // Старый и новый наборы слов упорядочены, поэтому сравниваются одним проходом
+    auto old_it = word_freqs.begin();
+    for (const auto [word, term_count] : word_counts) {
+        for (; old_it != word_freqs.end() && old_it->first < word; ++old_it) {
+            ErasePosting(term_ids_.at(old_it->first), ordinal);
+        }
+        int term_id;
+        if (old_it != word_freqs.end() && old_it->first == word) {
+            term_id = term_ids_.at(word);
+            if (std::llround(old_it->second / old_inv_word_count) != term_count) {
+                word_to_document_freqs_[term_id].Insert(ordinal, term_count);
+            }
+            word_max_term_freqs_[term_id] = std::max(word_max_term_freqs_[term_id], term_count * inv_word_count);
+            ++old_it;
+        } else {
+            term_id = GetOrAddTermId(word);
+            AddPosting(term_id, ordinal, term_count);
+            UpdateWordDocumentFreq(term_id);
+        }
+        new_word_freqs.emplace_hint(new_word_freqs.end(), term_words_[term_id], term_count * inv_word_count);
+    }
+    for (; old_it != word_freqs.end(); ++old_it) {
+        ErasePosting(term_ids_.at(old_it->first), ordinal);
+    }
+    word_freqs.swap(new_word_freqs);
+    ++index_version_;
+}
+
+void SearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    struct TokenizedDocument {
+        std::map<std::string_view, int> word_counts;
+        size_t word_count = 0;
+        std::exception_ptr error;
+    };
+
+    std::vector<TokenizedDocument> tokenized(documents.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        TokenizedDocument& result = tokenized[index];
+        try {
+            thread_local std::vector<std::string_view> words;
+            SplitIntoWordsNoStop(documents[index].text, words);
+            result.word_count = words.size();
+            for (std::string_view word : words) {
+                ++result.word_counts[word];
+            }
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+    });
+
+    std::exception_ptr error;
+    std::unordered_set<int> batch_ids;
+    size_t accepted_count = 0;
+    for (; accepted_count < documents.size(); ++accepted_count) {
+        const int document_id = documents[accepted_count].id;
+        if ((document_id < 0) || documents_.Contains(document_id) || !batch_ids.insert(document_id).second) {
+            error = std::make_exception_ptr(std::invalid_argument("Invalid document_id"s));
+            break;
+        }
+        if (tokenized[accepted_count].error) {
+            error = tokenized[accepted_count].error;
+            break;
+        }
+    }
+
+    std::vector<int> ordinals(accepted_count);
+    for (size_t index = 0; index < accepted_count; ++index) {
+        const DocumentInput& document = documents[index];
+        const double inv_word_count = 1.0 / tokenized[index].word_count;
+        ordinals[index] = documents_.Add(document.id, ComputeAverageRating(document.ratings), document.status, inv_word_count);
+        document_ids_.insert(document.id);
+    }
+
+    // Каждый поток строит частичный индекс по своему непрерывному диапазону документов,
+    // затем частичные индексы сливаются по порядку, поэтому списки вхождений остаются отсортированными
+    const size_t chunk_count = std::min<size_t>(accepted_count, std::max(1u, std::thread::hardware_concurrency()) * 4);
+    std::vector<std::unordered_map<std::string_view, std::vector<Posting>>> partial_indexes(chunk_count);
+    std::vector<size_t> chunks(chunk_count);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk) {
+        auto& partial_index = partial_indexes[chunk];
+        for (size_t index = accepted_count * chunk / chunk_count; index < accepted_count * (chunk + 1) / chunk_count; ++index) {
+            for (const auto [word, term_count] : tokenized[index].word_counts) {
+                partial_index[word].push_back({ordinals[index], term_count});
+            }
+        }
+    });
+    std::vector<int> touched_term_ids;
+    std::vector<bool> is_touched;
+    for (const auto& partial_index : partial_indexes) {
+        for (const auto& [word, postings] : partial_index) {
+            const int term_id = GetOrAddTermId(word);
+            if (static_cast<size_t>(term_id) >= is_touched.size()) {
+                is_touched.resize(word_to_document_freqs_.size());
+            }
+            if (!is_touched[term_id]) {
+                is_touched[term_id] = true;
+                touched_term_ids.push_back(term_id);
+            }
+            for (const Posting& posting : postings) {
+                AddPosting(term_id, posting.document_id, posting.term_count);
+            }
+        }
+    }
+    for (size_t index = 0; index < accepted_count; ++index) {
+        const double inv_word_count = documents_.GetInvWordCount(ordinals[index]);
+        auto& word_freqs = word_freq_[documents[index].id];
+        for (const auto [word, term_count] : tokenized[index].word_counts) {
+            word_freqs.emplace_hint(word_freqs.end(), term_words_[term_ids_.at(word)], term_count * inv_word_count);
+        }
+    }
+    std::for_each(std::execution::par, touched_term_ids.begin(), touched_term_ids.end(), [this](int term_id) {
+        UpdateWordDocumentFreq(term_id);
+    });
+    UpdateDocumentCount();
+    ++index_version_;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, max_result_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+size_t SearchServer::FindTopDocuments(Scratch& scratch, std::string_view raw_query, DocumentStatus status, size_t max_result_count,
+                                      Document* documents) const {
+    ParseQuery(raw_query, scratch.query);
+    scratch.top_documents.Reset(max_result_count);
+    FindAllDocuments(scratch.query, StatusFilter{&documents_.GetStatusBitmap(status)}, scratch.excluded, scratch.accumulator,
+                     scratch.top_documents);
+    return scratch.top_documents.ExtractTo(documents);
+}
+
+SearchServer::Scratch& SearchServer::GetThreadScratch() {
+    thread_local Scratch scratch;
+    return scratch;
+}
+
+std::string SearchServer::NormalizeQuery(std::string_view raw_query) const {
+    const auto query = ParseQuery(raw_query);
+    std::string normalized_query;
+    for (std::string_view word : query.plus_words) {
+        normalized_query.append(word).push_back(' ');
+    }
+    for (std::string_view word : query.minus_words) {
+        normalized_query.append("-"s).append(word).push_back(' ');
+    }
+    if (!normalized_query.empty()) {
+        normalized_query.pop_back();
+    }
+    return normalized_query;
+}
+
+uint64_t SearchServer::GetIndexVersion() const {
+    return index_version_;
+}
+
 int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(documents_.size());
+    return documents_.GetLiveCount();
+}
+
+bool SearchServer::ContainsDocument(int document_id) const {
+    return documents_.Contains(document_id);
+}
+
+std::vector<std::pair<std::string_view, int>> SearchServer::GetQueryDocumentFreqs(std::string_view raw_query) const {
+    const auto query = ParseQuery(raw_query);
+    std::vector<std::pair<std::string_view, int>> document_freqs;
+    document_freqs.reserve(query.plus_words.size());
+    for (std::string_view word : query.plus_words) {
+        const int term_id = FindTermId(word);
+        document_freqs.emplace_back(word, term_id < 0 ? 0 : word_document_counts_[term_id]);
+    }
+    return document_freqs;
+}
+
+double SearchServer::ComputeInverseDocumentFreq(int document_count, int document_freq) {
+    // Те же логарифмы, что кэшируются индексом: результат совпадает побитово
+    return ComputeLogCount(document_count) - ComputeLogCount(document_freq);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
@@ -43,46 +295,116 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy& policy, std::string_view raw_query, int document_id) const {
-    const auto status = documents_.at(document_id).status;
+    const int ordinal = documents_.GetOrdinal(document_id);
+    const auto status = documents_.GetStatus(ordinal);
     const auto query = ParseQuery(raw_query);
     std::vector<std::string_view> matched_words;
     for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+        const PostingList* postings = FindPostings(word);
+        if (postings != nullptr && postings->Contains(ordinal)) {
             return {matched_words, status};
         }
     }
     for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        const auto it = term_ids_.find(word);
+        if (it != term_ids_.end() && word_to_document_freqs_[it->second].Contains(ordinal)) {
+            matched_words.push_back(it->first);
         }
     }
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, status};
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const {
+    const int ordinal = documents_.GetOrdinal(document_id);
+    const auto status = documents_.GetStatus(ordinal);
     const auto query = ParseQuery(raw_query, false);
+    const auto contains_document = [this, ordinal](std::string_view word) {
+        const PostingList* postings = FindPostings(word);
+        return postings != nullptr && postings->Contains(ordinal);
+    };
     std::vector<std::string_view> matched_words;
-    matched_words.reserve(query.plus_words.size());
-    if(!std::any_of(policy, query.minus_words.begin(),query.minus_words.end(),
-                    [this, document_id](auto word) {
-                        return word_to_document_freqs_.at(word).count(document_id);}))
-    {
-        auto matched_words_end = std::copy_if(policy,
-                                              query.plus_words.begin(), query.plus_words.end(),
-                                              matched_words.begin(),
-                                              [this, document_id](auto word){
-                                                  return word_to_document_freqs_.at(word).count(document_id);});
-        std::sort(matched_words.begin(), matched_words_end);
-        matched_words.erase(std::unique(matched_words.begin(),
-                                        matched_words_end), matched_words.end());
-    }
-    return {matched_words, documents_.at(document_id).status};
+    if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), contains_document)) {
+        return {matched_words, status};
+    }
+    matched_words.resize(query.plus_words.size());
+    std::transform(policy,
+                   query.plus_words.begin(), query.plus_words.end(),
+                   matched_words.begin(),
+                   [this, ordinal](std::string_view word) {
+                       const auto it = term_ids_.find(word);
+                       if (it != term_ids_.end() && word_to_document_freqs_[it->second].Contains(ordinal)) {
+                           return it->first;
+                       }
+                       return std::string_view();
+                   });
+    std::sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    if (!matched_words.empty() && matched_words.front().empty()) {
+        matched_words.erase(matched_words.begin());
+    }
+    return {matched_words, status};
+}
+
+DocumentBitmap SearchServer::BuildExclusionBitmap(const Query& query) const {
+    DocumentBitmap excluded;
+    BuildExclusionBitmap(query, excluded);
+    return excluded;
+}
+
+void SearchServer::BuildExclusionBitmap(const Query& query, DocumentBitmap& excluded) const {
+    excluded.Clear();
+    for (std::string_view word : query.minus_words) {
+        const PostingList* postings = FindPostings(word);
+        if (postings != nullptr) {
+            postings->ForEach([&excluded](int ordinal, int) {
+                excluded.Set(ordinal);
+            });
+        }
+    }
+}
+
+int SearchServer::ComputeOrdinalRangeSize() const {
+    static const int MAX_RANGE_SIZE = 1 << 16;
+    const int task_count = 4 * static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    return std::clamp(documents_.GetOrdinalCount() / task_count + 1, 1, MAX_RANGE_SIZE);
+}
+
+void SearchServer::MergeWordRelevances(const std::execution::parallel_policy& policy,
+                                       const std::vector<std::vector<OrdinalRelevance>>& word_relevances,
+                                       TopDocuments& top_documents) const {
+    const int ordinal_count = documents_.GetOrdinalCount();
+    const int range_size = ComputeOrdinalRangeSize();
+    const int range_count = (ordinal_count + range_size - 1) / range_size;
+    std::vector<std::vector<Document>> range_documents(range_count);
+    std::vector<int> ranges(range_count);
+    std::iota(ranges.begin(), ranges.end(), 0);
+    std::for_each(policy, ranges.begin(), ranges.end(), [&](int range) {
+        thread_local RelevanceAccumulator accumulator;
+        const int first = range * range_size;
+        const int last = std::min(first + range_size, ordinal_count);
+        accumulator.Reset(first, last - first);
+        const auto less_ordinal = [](const OrdinalRelevance& item, int ordinal) {
+            return item.ordinal < ordinal;
+        };
+        for (const auto& word_relevance : word_relevances) {
+            for (auto it = std::lower_bound(word_relevance.begin(), word_relevance.end(), first, less_ordinal);
+                 it != word_relevance.end() && it->ordinal < last; ++it) {
+                accumulator.Add(it->ordinal, it->relevance);
+            }
+        }
+        accumulator.ForEachMatched([&](int ordinal, double relevance) {
+            range_documents[range].push_back({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+        });
+    });
+    PushRangeDocuments(range_documents, top_documents);
+}
+
+void SearchServer::PushRangeDocuments(const std::vector<std::vector<Document>>& range_documents, TopDocuments& top_documents) {
+    for (const std::vector<Document>& documents : range_documents) {
+        for (const Document& document : documents) {
+            top_documents.Push(document);
+        }
+    }
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const {
@@ -95,17 +417,81 @@ bool SearchServer::IsValidWord(std::string_view word) {
     });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
-        }
+void SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const {
+    const size_t control_pos = SplitIntoWords(text, words);
+    if (control_pos != std::string_view::npos) {
+        // Управляющий символ не может быть разделителем, поэтому он лежит внутри первого недопустимого слова
+        const auto word = *std::prev(std::upper_bound(words.begin(), words.end(), text.data() + control_pos,
+                                                      [](const char* pos, std::string_view word) {
+                                                          return pos < word.data();
+                                                      }));
+        throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
+    }
+    if (!stop_words_.empty()) {
+        words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+            return IsStopWord(word);
+        }), words.end());
+    }
+}
+
+int SearchServer::GetOrAddTermId(std::string_view word) {
+    const auto it = term_ids_.find(word);
+    if (it != term_ids_.end()) {
+        return it->second;
+    }
+    const std::string_view stored_word = text_arena_.Store(word);
+    int term_id;
+    if (!free_term_ids_.empty()) {
+        term_id = free_term_ids_.back();
+        free_term_ids_.pop_back();
+        term_words_[term_id] = stored_word;
+        word_to_document_freqs_[term_id] = PostingList(postings_format_);
+        word_log_document_freqs_[term_id] = 0.0;
+        word_max_term_freqs_[term_id] = 0.0;
+        word_document_counts_[term_id] = 0;
+    } else {
+        term_id = static_cast<int>(word_to_document_freqs_.size());
+        term_words_.push_back(stored_word);
+        word_to_document_freqs_.emplace_back(postings_format_);
+        word_log_document_freqs_.push_back(0.0);
+        word_max_term_freqs_.push_back(0.0);
+        word_document_counts_.push_back(0);
+    }
+    term_ids_.emplace(stored_word, term_id);
+    dead_term_bytes_ += stored_word.size();
+    return term_id;
+}
+
+void SearchServer::AddPosting(int term_id, int ordinal, int term_count) {
+    if (word_document_counts_[term_id]++ == 0) {
+        dead_term_bytes_ -= term_words_[term_id].size();
+    }
+    word_to_document_freqs_[term_id].Insert(ordinal, term_count);
+    word_max_term_freqs_[term_id] = std::max(word_max_term_freqs_[term_id], term_count * documents_.GetInvWordCount(ordinal));
+}
+
+size_t SearchServer::ReleasePosting(int term_id) {
+    if (--word_document_counts_[term_id] == 0) {
+        word_max_term_freqs_[term_id] = 0.0;
+        return term_words_[term_id].size();
     }
-    return words;
+    return 0;
+}
+
+void SearchServer::ErasePosting(int term_id, int ordinal) {
+    word_to_document_freqs_[term_id].Erase(ordinal);
+    dead_term_bytes_ += ReleasePosting(term_id);
+    UpdateWordDocumentFreq(term_id);
+}
+
+int SearchServer::FindTermId(std::string_view word) const {
+    const auto it = term_ids_.find(word);
+    return it == term_ids_.end() ? -1 : it->second;
+}
+
+const PostingList* SearchServer::FindPostings(std::string_view word) const {
+    const int term_id = FindTermId(word);
+    return term_id < 0 ? nullptr : &word_to_document_freqs_[term_id];
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -115,7 +501,7 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return accumulate(ratings.begin(), ratings.end(), 0)/static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text, bool has_control_chars) {
     if (text.empty()) {
         throw std::invalid_argument("Query word is empty"s);
     }
@@ -125,35 +511,48 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    if (word.empty() || word[0] == '-' || has_control_chars) {
         throw std::invalid_argument("Query word "s + std::string(text) + " is invalid"s);
     }
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus};
 }
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, const bool is_seq) const {
     Query result;
-    for (std::string_view word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
-            } else {
-                result.plus_words.push_back(query_word.data);
-            }
-        }
-    }
-    if(is_seq){
-        std::sort(result.plus_words.begin(), result.plus_words.end());
-        result.plus_words.erase(std::unique(result.plus_words.begin(), result.plus_words.end()), result.plus_words.end());
-        std::sort(result.minus_words.begin(), result.minus_words.end());
-        result.minus_words.erase(std::unique(result.minus_words.begin(), result.minus_words.end()), result.minus_words.end());
-    }
+    ParseQuery(text, result, is_seq);
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::ParseQuery(std::string_view text, Query& result, const bool is_seq) const {
+    ParseQuery(text, [this](std::string_view word) {
+        return IsStopWord(word);
+    }, result, is_seq);
+}
+
+double SearchServer::ComputeLogCount(int count) {
+    return count > 0 ? log(static_cast<double>(count)) : 0.0;
+}
+
+void SearchServer::UpdateWordDocumentFreq(int term_id) {
+    word_log_document_freqs_[term_id] = ComputeLogCount(word_document_counts_[term_id]);
+}
+
+void SearchServer::UpdateDocumentCount() {
+    log_document_count_ = ComputeLogCount(GetDocumentCount());
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(int term_id) const {
+    return log_document_count_ - word_log_document_freqs_[term_id];
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(const Query& query, std::string_view word, int term_id) const {
+    if (query.inverse_document_freqs != nullptr) {
+        const auto it = query.inverse_document_freqs->find(word);
+        if (it != query.inverse_document_freqs->end()) {
+            return it->second;
+        }
+    }
+    return ComputeWordInverseDocumentFreq(term_id);
 }
 
 typename std::set<int>::const_iterator SearchServer::begin() const {
@@ -165,28 +564,114 @@ typename std::set<int>::const_iterator SearchServer::end() const {
 }
 
 const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    if(lower_bound(document_ids_.begin(), document_ids_.end(), document_id) != document_ids_.end()) {
-        return word_freq_.at(document_id);
+    const auto it = word_freq_.find(document_id);
+    if (it != word_freq_.end()) {
+        return it->second;
     } else {
         static const std::map<std::string_view, double> empty_map;
         return empty_map;
     }
 }
 
+void SearchServer::SetPostingsFormat(PostingsFormat format) {
+    std::for_each(std::execution::par,
+                  word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                  [format](PostingList& postings) {
+                      postings.SetFormat(format);
+                  });
+    postings_format_ = format;
+}
+
+PostingsFormat SearchServer::GetPostingsFormat() const {
+    return postings_format_;
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const {
+    return std::transform_reduce(std::execution::par,
+                                 word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                                 size_t{0}, std::plus<>(),
+                                 [](const PostingList& postings) {
+                                     return postings.GetMemoryUsage();
+                                 });
+}
+
+void SearchServer::CompactTextStore() {
+    TextArena text_arena;
+    std::unordered_map<std::string_view, int> term_ids;
+    term_ids.reserve(term_ids_.size());
+    std::vector<std::string_view> term_words(term_words_.size());
+    for (const auto [word, term_id] : term_ids_) {
+        if (word_document_counts_[term_id] == 0) {
+            word_to_document_freqs_[term_id] = PostingList(postings_format_);
+            free_term_ids_.push_back(term_id);
+        } else {
+            term_words[term_id] = text_arena.Store(word);
+            term_ids.emplace(term_words[term_id], term_id);
+        }
+    }
+    std::for_each(std::execution::par, word_freq_.begin(), word_freq_.end(), [&](auto& document_word_freqs) {
+        std::map<std::string_view, double> word_freqs;
+        for (const auto [word, term_freq] : document_word_freqs.second) {
+            word_freqs.emplace_hint(word_freqs.end(), term_words[term_ids_.at(word)], term_freq);
+        }
+        document_word_freqs.second.swap(word_freqs);
+    });
+    term_ids_.swap(term_ids);
+    term_words_.swap(term_words);
+    text_arena_ = std::move(text_arena);
+    dead_term_bytes_ = 0;
+}
+
+size_t SearchServer::GetReclaimableTextBytes() const {
+    return dead_term_bytes_;
+}
+
+void SearchServer::SetParallelQueryMode(ParallelQueryMode mode) {
+    parallel_query_mode_ = mode;
+}
+
+ParallelQueryMode SearchServer::GetParallelQueryMode() const {
+    return parallel_query_mode_;
+}
+
+void SearchServer::SetRetrievalMode(RetrievalMode mode) {
+    retrieval_mode_ = mode;
+}
+
+RetrievalMode SearchServer::GetRetrievalMode() const {
+    return retrieval_mode_;
+}
+
+PruningStats SearchServer::GetPruningStats() const {
+    return {pruning_counters_.total_postings.load(), pruning_counters_.scored_postings.load()};
+}
+
+void SearchServer::ResetPruningStats() {
+    pruning_counters_.total_postings = 0;
+    pruning_counters_.scored_postings = 0;
+}
+
 void SearchServer::RemoveDocument(int document_id) {
     RemoveDocument(std::execution::seq, document_id);
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) {
+    const int ordinal = documents_.GetOrdinal(document_id);
     for(auto [key, value] : word_freq_.at(document_id)) {
-        word_to_document_freqs_.at(key).erase(document_id);
+        const int term_id = term_ids_.at(key);
+        dead_term_bytes_ += ReleasePosting(term_id);
+        UpdateWordDocumentFreq(term_id);
     }
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    documents_.Remove(ordinal);
     word_freq_.erase(document_id);
+    UpdateDocumentCount();
+    ++index_version_;
+    CompactPostingsIfNeeded();
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
+    const int ordinal = documents_.GetOrdinal(document_id);
     auto& word_freq = word_freq_.at(document_id);
     std::vector<std::string_view> document_words(word_freq.size());
     std::transform(policy,
@@ -194,11 +679,104 @@ void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy,
                    document_words.begin(),
                    [](const auto& word){
                        return word.first;});
-    std::for_each(policy,
-                  document_words.begin(), document_words.end(),
-                  [document_id, this](std::string_view word){
-                      word_to_document_freqs_.at(word).erase(document_id);});
+    dead_term_bytes_ += std::transform_reduce(policy,
+                                              document_words.begin(), document_words.end(),
+                                              size_t{0}, std::plus<>(),
+                                              [this](std::string_view word){
+                                                  const int term_id = term_ids_.at(word);
+                                                  const size_t freed_bytes = ReleasePosting(term_id);
+                                                  UpdateWordDocumentFreq(term_id);
+                                                  return freed_bytes;});
     document_ids_.erase(document_id);
-    documents_.erase(document_id);
+    documents_.Remove(ordinal);
     word_freq_.erase(document_id);
-}
\ No newline at end of file
+    UpdateDocumentCount();
+    ++index_version_;
+    CompactPostingsIfNeeded();
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    std::vector<int> ordinals;
+    ordinals.reserve(document_ids.size());
+    for (int document_id : document_ids) {
+        ordinals.push_back(documents_.GetOrdinal(document_id));
+    }
+    std::vector<bool> is_touched(word_to_document_freqs_.size());
+    std::vector<int> touched_term_ids;
+    for (size_t index = 0; index < document_ids.size(); ++index) {
+        const int document_id = document_ids[index];
+        const auto it = word_freq_.find(document_id);
+        if (it == word_freq_.end()) {
+            continue;
+        }
+        for (const auto& [word, term_freq] : it->second) {
+            const int term_id = term_ids_.at(word);
+            dead_term_bytes_ += ReleasePosting(term_id);
+            if (!is_touched[term_id]) {
+                is_touched[term_id] = true;
+                touched_term_ids.push_back(term_id);
+            }
+        }
+        document_ids_.erase(document_id);
+        documents_.Remove(ordinals[index]);
+        word_freq_.erase(it);
+    }
+    std::for_each(std::execution::par, touched_term_ids.begin(), touched_term_ids.end(), [this](int term_id) {
+        UpdateWordDocumentFreq(term_id);
+    });
+    UpdateDocumentCount();
+    ++index_version_;
+    CompactPostingsIfNeeded();
+}
+
+void SearchServer::CompactPostings() {
+    if (documents_.GetTombstoneCount() == 0) {
+        return;
+    }
+    const std::vector<int> new_ordinals = documents_.Compact();
+    std::vector<int> term_ids(word_to_document_freqs_.size());
+    std::iota(term_ids.begin(), term_ids.end(), 0);
+    std::for_each(std::execution::par, term_ids.begin(), term_ids.end(), [&](int term_id) {
+        PostingList& postings = word_to_document_freqs_[term_id];
+        if (word_document_counts_[term_id] == 0) {
+            postings = PostingList(postings_format_);
+            return;
+        }
+        postings.Remap(new_ordinals);
+        // Верхняя оценка TF снова становится точной
+        double max_term_freq = 0.0;
+        postings.ForEach([&](int ordinal, int term_count) {
+            max_term_freq = std::max(max_term_freq, term_count * documents_.GetInvWordCount(ordinal));
+        });
+        word_max_term_freqs_[term_id] = max_term_freq;
+    });
+    // Слова без документов убираются из словаря; их текст остаётся в хранилище до CompactTextStore
+    for (auto it = term_ids_.begin(); it != term_ids_.end();) {
+        if (word_document_counts_[it->second] == 0) {
+            free_term_ids_.push_back(it->second);
+            it = term_ids_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SearchServer::SetCompactionThreshold(double tombstone_ratio) {
+    compaction_threshold_ = tombstone_ratio;
+    CompactPostingsIfNeeded();
+}
+
+double SearchServer::GetCompactionThreshold() const {
+    return compaction_threshold_;
+}
+
+int SearchServer::GetTombstoneCount() const {
+    return documents_.GetTombstoneCount();
+}
+
+void SearchServer::CompactPostingsIfNeeded() {
+    const int tombstone_count = documents_.GetTombstoneCount();
+    if (tombstone_count > 0 && tombstone_count > compaction_threshold_ * documents_.GetOrdinalCount()) {
+        CompactPostings();
+    }
+}
@@ -1,9 +1,14 @@
 #pragma once
 
 #include "document.h"
+#include "document_table.h"
 #include "string_processing.h"
 #include "log_duration.h"
-#include "concurrent_map.h"
+#include "postings.h"
+#include "top_documents.h"
+#include "text_arena.h"
+#include "relevance_accumulator.h"
+#include "document_bitmap.h"
 
 #include <tuple>
 #include <stdexcept>
@@ -15,21 +20,59 @@
 #include <execution>
 #include <set>
 #include <string_view>
-#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <exception>
+#include <atomic>
+#include <cstdint>
+#include <limits>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
-const double EPSILON = 1e-6;
+// Способ распараллеливания запроса с политикой std::execution::par:
+// BY_WORDS — по плюс-словам запроса, BY_DOCUMENT_RANGES — по диапазонам документов,
+// AUTO — по диапазонам, если плюс-слов меньше, чем аппаратных потоков
+enum class ParallelQueryMode {
+    AUTO,
+    BY_WORDS,
+    BY_DOCUMENT_RANGES,
+};
+
+// Способ отбора лучших документов в последовательном поиске: EXHAUSTIVE считает
+// релевантность всех документов, MAX_SCORE ищет частые слова запроса только у документов,
+// которые по верхней оценке релевантности ещё могут попасть в результат. Результаты совпадают;
+// MAX_SCORE выигрывает на запросах, где частые слова соседствуют с редкими, а на запросах
+// из слов одинаковой частоты работает как EXHAUSTIVE
+enum class RetrievalMode {
+    EXHAUSTIVE,
+    MAX_SCORE,
+};
 
-enum class DocumentStatus {
-    ACTUAL,
-    IRRELEVANT,
-    BANNED,
-    REMOVED,
+// Число вхождений плюс-слов в запросах и число вхождений, по которым считалась релевантность
+struct PruningStats {
+    uint64_t total_postings = 0;
+    uint64_t scored_postings = 0;
+};
+
+// IDF плюс-слов запроса, посчитанная по нескольким индексам (сегментам, шардам) сразу:
+// с ней каждый индекс считает релевантность так, как если бы все документы лежали в нём
+using InverseDocumentFreqs = std::unordered_map<std::string_view, double>;
+
+// Документ для пакетного добавления. text не владеет строкой: она должна жить,
+// пока не завершится вызов AddDocuments
+struct DocumentInput {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
 };
 
 class SearchServer {
 public:
+    // Буферы, переиспользуемые между запросами одного потока (разбор запроса,
+    // накопитель релевантности, отбор лучших документов). Не разделяется между потоками
+    class Scratch;
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
 
@@ -39,32 +82,128 @@ public:
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Добавляет документы в порядке следования. Если какой-то документ некорректен,
+    // все предшествующие ему документы остаются добавленными и выбрасывается то же
+    // исключение, что и у AddDocument
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+
+    // Меняют только метаданные документа, не затрагивая списки вхождений.
+    // Если документа нет, выбрасывают std::out_of_range
+    void UpdateDocumentStatus(int document_id, DocumentStatus status);
+
+    void UpdateDocumentRating(int document_id, const std::vector<int>& ratings);
+
+    // Заменяет текст документа, сохраняя статус и рейтинг. Изменяются только вхождения
+    // слов, которые появились, исчезли или сменили число вхождений. Если текст некорректен,
+    // выбрасывает то же исключение, что и AddDocument, и документ не меняется
+    void UpdateDocument(int document_id, std::string_view document);
+
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
     template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
 
+    // Поиск с внешней IDF; для слов, которых нет в inverse_document_freqs, используется IDF этого индекса
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count, const InverseDocumentFreqs& inverse_document_freqs) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count, const InverseDocumentFreqs& inverse_document_freqs) const;
+
+    // Плюс-слова запроса (отсортированные, без повторов) и число документов с каждым из них
+    std::vector<std::pair<std::string_view, int>> GetQueryDocumentFreqs(std::string_view raw_query) const;
+
+    // IDF слова, встречающегося в document_freq из document_count документов
+    static double ComputeInverseDocumentFreq(int document_count, int document_freq);
+
+    // Последовательный поиск без выделения памяти под промежуточные структуры: результат
+    // записывается в documents (не менее max_result_count мест), возвращается число документов
+    size_t FindTopDocuments(Scratch& scratch, std::string_view raw_query, DocumentStatus status, size_t max_result_count,
+                            Document* documents) const;
+
+    // Запрос без стоп-слов: отсортированные уникальные плюс-слова, затем минус-слова.
+    // Запросы с одинаковой нормальной формой возвращают одинаковые результаты
+    std::string NormalizeQuery(std::string_view raw_query) const;
+
+    // Увеличивается при каждом добавлении и удалении документов
+    uint64_t GetIndexVersion() const;
+
     int GetDocumentCount() const;
 
+    bool ContainsDocument(int document_id) const;
+
     typename std::set<int>::const_iterator begin() const;
 
     typename std::set<int>::const_iterator end() const;
 
     const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
+    void SetPostingsFormat(PostingsFormat format);
+
+    PostingsFormat GetPostingsFormat() const;
+
+    size_t GetPostingsMemoryUsage() const;
+
+    void SetParallelQueryMode(ParallelQueryMode mode);
+
+    ParallelQueryMode GetParallelQueryMode() const;
+
+    void SetRetrievalMode(RetrievalMode mode);
+
+    RetrievalMode GetRetrievalMode() const;
+
+    PruningStats GetPruningStats() const;
+
+    void ResetPruningStats();
+
+    // Копирует используемые индексом слова в новое хранилище и освобождает память слов,
+    // которые больше не встречаются ни в одном документе. Ранее полученные string_view
+    // на слова индекса (из MatchDocument и GetWordFrequencies) становятся недействительными
+    void CompactTextStore();
+
+    size_t GetReclaimableTextBytes() const;
+
+    // Добавляет живые документы других индексов с теми же стоп-словами, не разбирая текст заново.
+    // Если какой-то id уже есть или повторяется, выбрасывает std::invalid_argument и ничего не добавляет
+    void AddDocumentsFrom(const std::vector<const SearchServer*>& sources);
+
+    // Удалённый документ сразу перестаёт находиться и учитываться в IDF, но его вхождения
+    // остаются в списках до уплотнения (CompactPostings)
     void RemoveDocument(int document_id);
 
+    // Удаляет документы пакетом: IDF затронутых слов и число документов пересчитываются
+    // один раз. Если какого-то id нет, выбрасывает std::out_of_range и ничего не удаляет
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // Удаляет из списков вхождений удалённые документы, нумерует оставшиеся подряд
+    // и освобождает слова, которые больше не встречаются в документах
+    void CompactPostings();
+
+    // Уплотнение запускается после удаления, если доля удалённых документов среди
+    // занятых номеров превышает порог; порог не меньше 1 отключает автоматическое уплотнение
+    void SetCompactionThreshold(double tombstone_ratio);
+
+    double GetCompactionThreshold() const;
+
+    int GetTombstoneCount() const;
+
     void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
 
     void RemoveDocument(const std::execution::parallel_policy& policy, int document_id);
@@ -76,18 +215,71 @@ public:
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const;
 
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
+    friend void SaveIndexSnapshot(const SearchServer& search_server, const std::string& path);
+
+    friend class MappedSearchServer;
 
     const std::set<std::string, std::less<>> stop_words_;
 
-    std::deque<std::string> words_;
+    // Каждое слово индекса хранится в text_arena_ в единственном экземпляре;
+    // на эти копии ссылаются term_ids_, term_words_ и word_freq_
+    TextArena text_arena_;
+
+    std::unordered_map<std::string_view, int> term_ids_;
+
+    std::vector<std::string_view> term_words_;
+
+    std::vector<int> free_term_ids_;
+
+    size_t dead_term_bytes_ = 0;
+
+    // Списки вхождений хранят порядковые номера документов из documents_, а не их id.
+    // До уплотнения в них остаются и удалённые документы
+    std::vector<PostingList> word_to_document_freqs_;
 
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
+    // Число живых документов со словом
+    std::vector<int> word_document_counts_;
 
-    std::map<int, DocumentData> documents_;
+    double compaction_threshold_ = 0.25;
+
+    PostingsFormat postings_format_ = PostingsFormat::PLAIN;
+
+    ParallelQueryMode parallel_query_mode_ = ParallelQueryMode::AUTO;
+
+    RetrievalMode retrieval_mode_ = RetrievalMode::EXHAUSTIVE;
+
+    // Счётчики копируются вместе с сервером, поэтому атомарные поля обёрнуты
+    struct PruningCounters {
+        std::atomic<uint64_t> total_postings{0};
+        std::atomic<uint64_t> scored_postings{0};
+
+        PruningCounters() = default;
+
+        PruningCounters(const PruningCounters& other)
+                : total_postings(other.total_postings.load()), scored_postings(other.scored_postings.load()) {}
+
+        PruningCounters& operator=(const PruningCounters& other) {
+            total_postings = other.total_postings.load();
+            scored_postings = other.scored_postings.load();
+            return *this;
+        }
+    };
+
+    mutable PruningCounters pruning_counters_;
+
+    // IDF слова равен log(N) - log(df): log(df) хранится для каждого слова и обновляется
+    // только при изменении df, log(N) — один на весь индекс
+    std::vector<double> word_log_document_freqs_;
+
+    // Максимальная TF слова по документам. При удалении документов не уменьшается и остаётся
+    // верхней оценкой до уплотнения; верхняя оценка вклада слова в релевантность равна max TF * IDF
+    std::vector<double> word_max_term_freqs_;
+
+    double log_document_count_ = 0.0;
+
+    uint64_t index_version_ = 0;
+
+    DocumentTable documents_;
 
     std::set<int> document_ids_;
 
@@ -97,35 +289,160 @@ private:
 
     static bool IsValidWord(std::string_view word);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    // Записывает в буфер words слова текста без стоп-слов
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
+
+    int GetOrAddTermId(std::string_view word);
+
+    int FindTermId(std::string_view word) const;
+
+    void AddPosting(int term_id, int ordinal, int term_count);
+
+    // Уменьшает число документов со словом. Возвращает число байт, ставших свободными,
+    // если слово больше не встречается в документах
+    size_t ReleasePosting(int term_id);
+
+    // Убирает вхождение живого документа из списка слова
+    void ErasePosting(int term_id, int ordinal);
+
+    void CompactPostingsIfNeeded();
+
+    const PostingList* FindPostings(std::string_view word) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
     struct QueryWord {
         std::string_view data;
         bool is_minus;
-        bool is_stop;
     };
 
-    QueryWord ParseQueryWord(std::string_view text) const;
+    static QueryWord ParseQueryWord(std::string_view text, bool has_control_chars);
 
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        const InverseDocumentFreqs* inverse_document_freqs = nullptr;
     };
 
     Query ParseQuery(std::string_view text, const bool is_seq = true) const;
 
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    void ParseQuery(std::string_view text, Query& result, const bool is_seq = true) const;
+
+    // Разбор запроса со стоп-словами, заданными предикатом; общий для SearchServer и MappedSearchServer
+    template <typename StopWordPredicate>
+    static void ParseQuery(std::string_view text, StopWordPredicate is_stop_word, Query& result, const bool is_seq = true);
+
+    // Логарифм числа документов (0 для пустого множества); IDF — разность таких логарифмов
+    static double ComputeLogCount(int count);
+
+    void UpdateWordDocumentFreq(int term_id);
+
+    void UpdateDocumentCount();
+
+    double ComputeWordInverseDocumentFreq(int term_id) const;
+
+    // Учитывает внешнюю IDF запроса, если она задана
+    double ComputeWordInverseDocumentFreq(const Query& query, std::string_view word, int term_id) const;
+
+    // Документы, содержащие хотя бы одно минус-слово запроса; строится до подсчёта релевантности
+    DocumentBitmap BuildExclusionBitmap(const Query& query) const;
+
+    void BuildExclusionBitmap(const Query& query, DocumentBitmap& excluded) const;
+
+    // Фильтр по статусу, проверяемый по битовой карте индекса без вызова предиката
+    struct StatusFilter {
+        const DocumentBitmap* documents;
+    };
+
+    template <typename DocumentPredicate>
+    bool IsAccepted(int ordinal, DocumentPredicate& document_predicate) const {
+        return documents_.IsAlive(ordinal)
+               && document_predicate(documents_.GetDocumentId(ordinal), documents_.GetStatus(ordinal), documents_.GetRating(ordinal));
+    }
+
+    bool IsAccepted(int ordinal, StatusFilter& status_filter) const {
+        return status_filter.documents->Test(ordinal);
+    }
+
+    struct OrdinalRelevance {
+        int ordinal;
+        double relevance;
+    };
+
+    // Размер диапазона порядковых номеров, обрабатываемого одной параллельной задачей
+    int ComputeOrdinalRangeSize() const;
+
+    // Отбирает найденные в диапазонах документы по возрастанию порядкового номера, как последовательный
+    // поиск: сравнение релевантности с точностью до EPSILON нетранзитивно, поэтому отбор лучших
+    // в каждом диапазоне по отдельности мог бы вернуть другой результат
+    static void PushRangeDocuments(const std::vector<std::vector<Document>>& range_documents, TopDocuments& top_documents);
+
+    // Вклады отдельных плюс-слов уже отсортированы по порядковому номеру документа, поэтому
+    // их можно сливать параллельно по непересекающимся диапазонам номеров без блокировок
+    void MergeWordRelevances(const std::execution::parallel_policy& policy,
+                             const std::vector<std::vector<OrdinalRelevance>>& word_relevances,
+                             TopDocuments& top_documents) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    void FindAllDocuments(const Query& query, DocumentPredicate document_predicate, TopDocuments& top_documents) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate) const;
+    void FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                          TopDocuments& top_documents) const;
 
+    // Последовательный поиск во внешних буферах; на нём основаны все последовательные перегрузки
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const;
+    void FindAllDocuments(const Query& query, DocumentPredicate document_predicate, DocumentBitmap& excluded,
+                          RelevanceAccumulator& accumulator, TopDocuments& top_documents) const;
+
+    // Подсчёт релевантности перебором вхождений плюс-слов, общий для SearchServer и MappedSearchServer.
+    // Index ищет слова (FindTermId, ComputeWordInverseDocumentFreq, ForEachPosting) и отбирает документы
+    // (IsAccepted), Documents возвращает их свойства по порядковому номеру
+    template <typename Index, typename Documents, typename DocumentPredicate>
+    static void ScoreDocuments(const Index& index, const Documents& documents, const Query& query, DocumentPredicate& document_predicate,
+                               const DocumentBitmap& excluded, RelevanceAccumulator& accumulator, TopDocuments& top_documents);
+
+    template <typename Visitor>
+    void ForEachPosting(int term_id, Visitor visitor) const {
+        word_to_document_freqs_[term_id].ForEach(visitor);
+    }
+
+    // Буферы последовательного поиска текущего потока
+    static Scratch& GetThreadScratch();
+
+    template <typename DocumentPredicate>
+    void FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                          TopDocuments& top_documents) const;
+
+    // MaxScore по окнам порядковых номеров: в каждом окне слова, без которых документ не наберёт
+    // порога отбора, считаются целиком, как при полном переборе, а остальные проверяются только
+    // у документов, которые ещё могут попасть в результат
+    template <typename DocumentPredicate>
+    void FindAllDocumentsMaxScore(const Query& query, DocumentPredicate& document_predicate, DocumentBitmap& excluded,
+                                  RelevanceAccumulator& accumulator, TopDocuments& top_documents) const;
+
+    template <typename DocumentPredicate>
+    void FindAllDocumentsByWords(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                 TopDocuments& top_documents) const;
+
+    // Каждый диапазон документов обрабатывается независимо: минус-слова и плюс-слова;
+    // затем найденные документы всех диапазонов отбираются одним проходом
+    template <typename DocumentPredicate>
+    void FindAllDocumentsByRanges(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                  TopDocuments& top_documents) const;
+};
+
+class SearchServer::Scratch {
+private:
+    friend class SearchServer;
+
+    Query query;
+
+    DocumentBitmap excluded;
+
+    RelevanceAccumulator accumulator;
+
+    TopDocuments top_documents{0};
 };
 
 template <typename StringContainer>
@@ -136,34 +453,68 @@ SearchServer::SearchServer(const StringContainer& stop_words)
     }
 }
 
+template <typename StopWordPredicate>
+void SearchServer::ParseQuery(std::string_view text, StopWordPredicate is_stop_word, Query& result, const bool is_seq) {
+    result.plus_words.clear();
+    result.inverse_document_freqs = nullptr;
+    result.minus_words.clear();
+    thread_local std::vector<std::string_view> words;
+    const size_t control_pos = SplitIntoWords(text, words);
+    for (std::string_view word : words) {
+        const bool has_control_chars = control_pos != std::string_view::npos
+                                       && text.data() + control_pos < word.data() + word.size();
+        const auto query_word = ParseQueryWord(word, has_control_chars);
+        if (!is_stop_word(query_word.data)) {
+            if (query_word.is_minus) {
+                result.minus_words.push_back(query_word.data);
+            } else {
+                result.plus_words.push_back(query_word.data);
+            }
+        }
+    }
+    if(is_seq){
+        std::sort(result.plus_words.begin(), result.plus_words.end());
+        result.plus_words.erase(std::unique(result.plus_words.begin(), result.plus_words.end()), result.plus_words.end());
+        std::sort(result.minus_words.begin(), result.minus_words.end());
+        result.minus_words.erase(std::unique(result.minus_words.begin(), result.minus_words.end()), result.minus_words.end());
+    }
+}
+
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     size_t max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, max_result_count);
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     size_t max_result_count) const {
     const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-    sort(policy, matched_documents.begin(), matched_documents.end(),
-         [](const Document &lhs, const Document &rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    TopDocuments top_documents(max_result_count);
+    FindAllDocuments(policy, query, document_predicate, top_documents);
+    return top_documents.Extract();
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     size_t max_result_count, const InverseDocumentFreqs& inverse_document_freqs) const {
+    auto query = ParseQuery(raw_query);
+    query.inverse_document_freqs = &inverse_document_freqs;
+    TopDocuments top_documents(max_result_count);
+    FindAllDocuments(policy, query, document_predicate, top_documents);
+    return top_documents.Extract();
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating){
-        return document_status == status;
-    });
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                                     size_t max_result_count, const InverseDocumentFreqs& inverse_document_freqs) const {
+    return FindTopDocuments(policy, raw_query, StatusFilter{&documents_.GetStatusBitmap(status)}, max_result_count, inverse_document_freqs);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                                     size_t max_result_count) const {
+    return FindTopDocuments(policy, raw_query, StatusFilter{&documents_.GetStatusBitmap(status)}, max_result_count);
 }
 
 template <typename ExecutionPolicy>
@@ -172,68 +523,286 @@ std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& poli
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
+void SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, TopDocuments& top_documents) const {
+    FindAllDocuments(std::execution::seq, query, document_predicate, top_documents);
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                    TopDocuments& top_documents) const {
+    Scratch& scratch = GetThreadScratch();
+    FindAllDocuments(query, document_predicate, scratch.excluded, scratch.accumulator, top_documents);
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
+void SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, DocumentBitmap& excluded,
+                                    RelevanceAccumulator& accumulator, TopDocuments& top_documents) const {
+    if (retrieval_mode_ == RetrievalMode::MAX_SCORE) {
+        FindAllDocumentsMaxScore(query, document_predicate, excluded, accumulator, top_documents);
+        return;
+    }
+    BuildExclusionBitmap(query, excluded);
+    ScoreDocuments(*this, documents_, query, document_predicate, excluded, accumulator, top_documents);
+}
+
+template <typename Index, typename Documents, typename DocumentPredicate>
+void SearchServer::ScoreDocuments(const Index& index, const Documents& documents, const Query& query, DocumentPredicate& document_predicate,
+                                  const DocumentBitmap& excluded, RelevanceAccumulator& accumulator, TopDocuments& top_documents) {
+    accumulator.Reset(0, documents.GetOrdinalCount());
     for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const int term_id = index.FindTermId(word);
+        if (term_id < 0) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        const double inverse_document_freq = index.ComputeWordInverseDocumentFreq(query, word, term_id);
+        index.ForEachPosting(term_id, [&](int ordinal, int term_count) {
+            if (!excluded.Test(ordinal) && index.IsAccepted(ordinal, document_predicate)) {
+                accumulator.Add(ordinal, term_count * documents.GetInvWordCount(ordinal) * inverse_document_freq);
             }
-        }
+        });
     }
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    accumulator.ForEachMatched([&](int ordinal, double relevance) {
+        top_documents.Push({documents.GetDocumentId(ordinal), relevance, documents.GetRating(ordinal)});
+    });
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocumentsMaxScore(const Query& query, DocumentPredicate& document_predicate, DocumentBitmap& excluded,
+                                            RelevanceAccumulator& accumulator, TopDocuments& top_documents) const {
+    // Запас на погрешность округления: оценки суммируются в ином порядке, чем релевантность
+    static const double BOUND_SLACK = 1.0 + 1e-9;
+    // Первые окна малы, чтобы порог отбора появился до обработки основной части документов
+    static const int FIRST_WINDOW_SIZE = 64;
+    static const int MAX_WINDOW_SIZE = 4096;
+
+    struct TermCursor {
+        const PostingList* postings;
+        PostingList::Cursor cursor;
+        double inverse_document_freq;
+        double upper_bound;
+        // В текущем окне слово проверяется только у кандидатов
+        bool probed;
+    };
+
+    struct Candidate {
+        int ordinal;
+        double relevance;
+        // Релевантность посчитана в порядке слов запроса, как при полном переборе
+        bool exact;
+    };
+
+    // Слова в порядке запроса: в нём суммируется релевантность, как при полном переборе
+    std::vector<TermCursor> terms;
+    // Курсоры для пересчёта релевантности создаются, только когда он понадобится
+    std::vector<PostingList::Cursor> exact_cursors;
+    uint64_t total_postings = 0;
+    for (std::string_view word : query.plus_words) {
+        const int term_id = FindTermId(word);
+        if (term_id < 0 || word_to_document_freqs_[term_id].empty()) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        const PostingList& postings = word_to_document_freqs_[term_id];
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(query, word, term_id);
+        terms.push_back({&postings, PostingList::Cursor(postings), inverse_document_freq,
+                         word_max_term_freqs_[term_id] * inverse_document_freq * BOUND_SLACK, false});
+        total_postings += postings.size();
+    }
+    pruning_counters_.total_postings += total_postings;
+    if (terms.empty()) {
+        return;
+    }
+    BuildExclusionBitmap(query, excluded);
+
+    // Слова по возрастанию верхней оценки; первые non_essential_count из них вместе не дают
+    // порога отбора, поэтому документ, в котором есть только они, в результат не попадёт
+    std::vector<TermCursor*> by_bound;
+    for (TermCursor& term : terms) {
+        by_bound.push_back(&term);
+    }
+    std::sort(by_bound.begin(), by_bound.end(), [](const TermCursor* lhs, const TermCursor* rhs) {
+        return lhs->upper_bound < rhs->upper_bound;
+    });
+    std::vector<double> bound_prefix_sums(by_bound.size() + 1, 0.0);
+    for (size_t i = 0; i < by_bound.size(); ++i) {
+        bound_prefix_sums[i + 1] = bound_prefix_sums[i] + by_bound[i]->upper_bound;
+    }
+
+    const int ordinal_count = documents_.GetOrdinalCount();
+    std::vector<TermCursor*> probed_terms;
+    std::vector<double> probed_bound_sums;
+    std::vector<Candidate> candidates;
+    uint64_t scored_postings = 0;
+    double threshold = top_documents.GetMinCompetitiveRelevance();
+    size_t non_essential_count = 0;
+
+    for (int first = 0, window_size = FIRST_WINDOW_SIZE; first < ordinal_count;
+         first += window_size, window_size = std::min(2 * window_size, MAX_WINDOW_SIZE)) {
+        while (non_essential_count < by_bound.size() && bound_prefix_sums[non_essential_count + 1] < threshold) {
+            ++non_essential_count;
+        }
+        if (non_essential_count == by_bound.size()) {
+            break;
+        }
+        const int last = std::min(first + window_size, ordinal_count);
+
+        // Кандидатов не больше, чем вхождений обязательных слов, поэтому необязательное слово ищется
+        // у кандидатов, только если его вхождений больше; иначе оно считается вместе с обязательными
+        size_t essential_postings = 0;
+        for (size_t i = non_essential_count; i < by_bound.size(); ++i) {
+            essential_postings += by_bound[i]->postings->size();
+        }
+        probed_terms.clear();
+        probed_bound_sums.assign(1, 0.0);
+        for (size_t i = 0; i < by_bound.size(); ++i) {
+            TermCursor& term = *by_bound[i];
+            term.probed = i < non_essential_count && term.postings->size() > essential_postings;
+            if (term.probed) {
+                probed_terms.push_back(&term);
+                probed_bound_sums.push_back(probed_bound_sums.back() + term.upper_bound);
+            }
+        }
+
+        // Остальные слова окна считаются целиком и в порядке запроса
+        accumulator.Reset(first, last - first);
+        for (TermCursor& term : terms) {
+            if (term.probed) {
+                continue;
+            }
+            term.cursor.SeekTo(first);
+            term.cursor.ForEachBefore(last, [&](int ordinal, int term_count) {
+                if (!excluded.Test(ordinal)) {
+                    accumulator.Add(ordinal, term_count * documents_.GetInvWordCount(ordinal) * term.inverse_document_freq);
+                    ++scored_postings;
+                }
+            });
+        }
+        candidates.clear();
+        accumulator.ForEachMatched([&](int ordinal, double relevance) {
+            if (relevance * BOUND_SLACK + probed_bound_sums.back() >= threshold) {
+                candidates.push_back({ordinal, relevance, true});
+            }
+        });
+
+        // Проверяемые слова ищутся у кандидатов от сильных к слабым, пока документ ещё может набрать порог
+        for (size_t i = probed_terms.size(); i-- > 0 && !candidates.empty();) {
+            TermCursor& term = *probed_terms[i];
+            auto kept = candidates.begin();
+            for (Candidate candidate : candidates) {
+                term.cursor.SeekTo(candidate.ordinal);
+                if (!term.cursor.AtEnd() && term.cursor.GetDocumentId() == candidate.ordinal) {
+                    candidate.relevance += term.cursor.GetTermCount() * documents_.GetInvWordCount(candidate.ordinal) * term.inverse_document_freq;
+                    candidate.exact = false;
+                    ++scored_postings;
+                }
+                if (candidate.relevance * BOUND_SLACK + probed_bound_sums[i] >= threshold) {
+                    *kept++ = candidate;
+                }
+            }
+            candidates.erase(kept, candidates.end());
+        }
+
+        // Документы отбираются по возрастанию порядкового номера, как при полном переборе,
+        // а релевантность с учётом проверенных слов пересчитывается в порядке слов запроса
+        for (const auto [ordinal, relevance_estimate, exact] : candidates) {
+            if (relevance_estimate * BOUND_SLACK < threshold || !IsAccepted(ordinal, document_predicate)) {
+                continue;
+            }
+            double relevance = relevance_estimate;
+            if (!exact) {
+                if (exact_cursors.empty()) {
+                    for (const TermCursor& term : terms) {
+                        exact_cursors.emplace_back(*term.postings);
+                    }
+                }
+                const double inv_word_count = documents_.GetInvWordCount(ordinal);
+                relevance = 0.0;
+                for (size_t i = 0; i < terms.size(); ++i) {
+                    PostingList::Cursor& cursor = exact_cursors[i];
+                    cursor.SeekTo(ordinal);
+                    if (!cursor.AtEnd() && cursor.GetDocumentId() == ordinal) {
+                        relevance += cursor.GetTermCount() * inv_word_count * terms[i].inverse_document_freq;
+                    }
+                }
+            }
+            top_documents.Push({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+            threshold = top_documents.GetMinCompetitiveRelevance();
         }
     }
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+    pruning_counters_.scored_postings += scored_postings;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                    TopDocuments& top_documents) const {
+    const bool by_ranges = parallel_query_mode_ == ParallelQueryMode::BY_DOCUMENT_RANGES
+                           || (parallel_query_mode_ == ParallelQueryMode::AUTO
+                               && query.plus_words.size() < std::max(1u, std::thread::hardware_concurrency()));
+    if (by_ranges) {
+        FindAllDocumentsByRanges(policy, query, document_predicate, top_documents);
+    } else {
+        FindAllDocumentsByWords(policy, query, document_predicate, top_documents);
     }
-    return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(100);
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-                  [&](const std::string_view word){
-                      if (word_to_document_freqs_.count(word) == 0) {
-                          return;
-                      }
-                      const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                      for (const auto [document_id, term_freq]: word_to_document_freqs_.at(word)) {
-                          const auto& document_data = documents_.at(document_id);
-                          if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                              document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                          }
-                      }
+void SearchServer::FindAllDocumentsByWords(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                           TopDocuments& top_documents) const {
+    const DocumentBitmap excluded = BuildExclusionBitmap(query);
+    std::vector<std::vector<OrdinalRelevance>> word_relevances(query.plus_words.size());
+    std::transform(policy, query.plus_words.begin(), query.plus_words.end(), word_relevances.begin(),
+                   [&](const std::string_view word){
+                       std::vector<OrdinalRelevance> relevances;
+                       const int term_id = FindTermId(word);
+                       if (term_id < 0) {
+                           return relevances;
+                       }
+                       const double inverse_document_freq = ComputeWordInverseDocumentFreq(query, word, term_id);
+                       relevances.reserve(word_to_document_freqs_[term_id].size());
+                       word_to_document_freqs_[term_id].ForEach([&](int ordinal, int term_count) {
+                           if (!excluded.Test(ordinal) && IsAccepted(ordinal, document_predicate)) {
+                               relevances.push_back({ordinal, term_count * documents_.GetInvWordCount(ordinal) * inverse_document_freq});
+                           }
+                       });
+                       return relevances;
     });
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(),
-                  [&](const std::string_view word){
-                      if (word_to_document_freqs_.count(word) == 0) {
-                          return;
-                      }
-                      for (const auto [document_id, _]: word_to_document_freqs_.at(word)) {
-                          document_to_relevance.erase(document_id);
-                      }
+    MergeWordRelevances(policy, word_relevances, top_documents);
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocumentsByRanges(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate,
+                                            TopDocuments& top_documents) const {
+    std::vector<std::pair<const PostingList*, double>> plus_postings;
+    for (std::string_view word : query.plus_words) {
+        const int term_id = FindTermId(word);
+        if (term_id >= 0) {
+            plus_postings.emplace_back(&word_to_document_freqs_[term_id], ComputeWordInverseDocumentFreq(query, word, term_id));
+        }
+    }
+    if (plus_postings.empty()) {
+        return;
+    }
+    const DocumentBitmap excluded = BuildExclusionBitmap(query);
+    const int ordinal_count = documents_.GetOrdinalCount();
+    const int range_size = ComputeOrdinalRangeSize();
+    const int range_count = (ordinal_count + range_size - 1) / range_size;
+    std::vector<std::vector<Document>> range_documents(range_count);
+    std::vector<int> ranges(range_count);
+    std::iota(ranges.begin(), ranges.end(), 0);
+    std::for_each(policy, ranges.begin(), ranges.end(), [&](int range) {
+        thread_local RelevanceAccumulator accumulator;
+        const int first = range * range_size;
+        const int last = std::min(first + range_size, ordinal_count);
+        accumulator.Reset(first, last - first);
+        for (const auto& [postings, inverse_document_freq] : plus_postings) {
+            postings->ForEachInRange(first, last, [&](int ordinal, int term_count) {
+                if (!excluded.Test(ordinal) && IsAccepted(ordinal, document_predicate)) {
+                    accumulator.Add(ordinal, term_count * documents_.GetInvWordCount(ordinal) * inverse_document_freq);
+                }
+            });
+        }
+        accumulator.ForEachMatched([&](int ordinal, double relevance) {
+            range_documents[range].push_back({documents_.GetDocumentId(ordinal), relevance, documents_.GetRating(ordinal)});
+        });
     });
-    auto doc_to_rel = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents(doc_to_rel.size());
-    std::transform(policy, doc_to_rel.begin(), doc_to_rel.end(), matched_documents.begin(),
-                   [this](const auto& doc){return Document{doc.first, doc.second, documents_.at(doc.first).rating};});
-    return matched_documents;
+    PushRangeDocuments(range_documents, top_documents);
 }
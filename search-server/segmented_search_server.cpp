@@ -0,0 +1,301 @@
+#include "segmented_search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+using namespace std::string_literals;
+
+SegmentedSearchServer::Segment::Segment(SearchServer index, size_t level)
+        : index(std::move(index)), level(level) {}
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string& stop_words_text, const SegmentedIndexOptions& options)
+        : SegmentedSearchServer(std::string_view(stop_words_text), options) {}
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words_text, const SegmentedIndexOptions& options)
+        : SegmentedSearchServer(SplitIntoWords(stop_words_text), options) {}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    if (merge_thread_.joinable()) {
+        {
+            const std::lock_guard lock(merge_mutex_);
+            is_stopping_ = true;
+        }
+        merge_requested_cv_.notify_one();
+        merge_thread_.join();
+    }
+}
+
+std::unique_ptr<SearchServer> SegmentedSearchServer::MakeMutableSegment() const {
+    return std::make_unique<SearchServer>(stop_words_);
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    bool is_sealed = false;
+    {
+        const std::unique_lock lock(mutex_);
+        if (document_ids_.count(document_id) > 0) {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+        mutable_segment_->AddDocument(document_id, document, status, ratings);
+        document_ids_.insert(document_id);
+        if (static_cast<size_t>(mutable_segment_->GetDocumentCount()) >= options_.max_mutable_documents) {
+            Seal();
+            is_sealed = true;
+        }
+    }
+    if (is_sealed) {
+        RequestMerge();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    const std::unique_lock lock(mutex_);
+    if (document_ids_.erase(document_id) == 0) {
+        throw std::out_of_range("Document "s + std::to_string(document_id) + " not found"s);
+    }
+    if (mutable_segment_->ContainsDocument(document_id)) {
+        mutable_segment_->RemoveDocument(document_id);
+        return;
+    }
+    for (const auto& segment : sealed_segments_) {
+        if (!segment->index.ContainsDocument(document_id) || segment->pending_deletes.count(document_id) > 0) {
+            continue;
+        }
+        if (!segment->is_merging) {
+            segment->index.RemoveDocument(document_id);
+            return;
+        }
+        segment->pending_deletes.insert(document_id);
+        for (const auto& [word, term_freq] : segment->index.GetWordFrequencies(document_id)) {
+            const auto it = pending_document_freqs_.find(word);
+            if (it == pending_document_freqs_.end()) {
+                pending_document_freqs_.emplace(std::string(word), 1);
+            } else {
+                ++it->second;
+            }
+        }
+        return;
+    }
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                              size_t max_result_count) const {
+    return FindTopDocuments(raw_query, [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    }, max_result_count);
+}
+
+SegmentedSearchServer::MatchResult SegmentedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    const std::shared_lock lock(mutex_);
+    if (document_ids_.count(document_id) == 0) {
+        throw std::out_of_range("Document "s + std::to_string(document_id) + " not found"s);
+    }
+    const SearchServer* owner = mutable_segment_.get();
+    for (const auto& segment : sealed_segments_) {
+        if (segment->index.ContainsDocument(document_id) && segment->pending_deletes.count(document_id) == 0) {
+            owner = &segment->index;
+        }
+    }
+    const auto [words, status] = owner->MatchDocument(raw_query, document_id);
+    return {std::vector<std::string>(words.begin(), words.end()), status};
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    const std::shared_lock lock(mutex_);
+    return static_cast<int>(document_ids_.size());
+}
+
+InverseDocumentFreqs SegmentedSearchServer::ComputeInverseDocumentFreqs(std::string_view raw_query) const {
+    // Все сегменты разбирают запрос одинаково, поэтому списки слов совпадают по порядку
+    auto document_freqs = mutable_segment_->GetQueryDocumentFreqs(raw_query);
+    for (const auto& segment : sealed_segments_) {
+        const auto segment_document_freqs = segment->index.GetQueryDocumentFreqs(raw_query);
+        for (size_t i = 0; i < document_freqs.size(); ++i) {
+            document_freqs[i].second += segment_document_freqs[i].second;
+        }
+    }
+    InverseDocumentFreqs inverse_document_freqs;
+    const int document_count = static_cast<int>(document_ids_.size());
+    for (auto [word, document_freq] : document_freqs) {
+        const auto it = pending_document_freqs_.find(word);
+        if (it != pending_document_freqs_.end()) {
+            document_freq -= it->second;
+        }
+        inverse_document_freqs.emplace(word, SearchServer::ComputeInverseDocumentFreq(document_count, document_freq));
+    }
+    return inverse_document_freqs;
+}
+
+void SegmentedSearchServer::Seal() {
+    if (mutable_segment_->GetDocumentCount() == 0) {
+        return;
+    }
+    SearchServer& index = *mutable_segment_;
+    index.CompactPostings();
+    index.CompactTextStore();
+    index.SetPostingsFormat(options_.sealed_postings_format);
+    // Удаления из запечатанного сегмента только помечают документы
+    index.SetCompactionThreshold(1.0);
+    sealed_segments_.push_back(std::make_shared<Segment>(std::move(index), 0));
+    mutable_segment_ = MakeMutableSegment();
+    ++seal_count_;
+}
+
+void SegmentedSearchServer::Flush() {
+    {
+        const std::unique_lock lock(mutex_);
+        Seal();
+    }
+    RequestMerge();
+}
+
+void SegmentedSearchServer::RequestMerge() {
+    if (!options_.background_merge) {
+        RunMerges();
+        return;
+    }
+    {
+        const std::lock_guard lock(merge_mutex_);
+        is_merge_requested_ = true;
+    }
+    merge_requested_cv_.notify_one();
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+    std::unique_lock lock(merge_mutex_);
+    merge_done_cv_.wait(lock, [this] {
+        return !is_merge_requested_ && !is_merge_running_;
+    });
+}
+
+void SegmentedSearchServer::RunMergeLoop() {
+    std::unique_lock lock(merge_mutex_);
+    while (true) {
+        merge_requested_cv_.wait(lock, [this] {
+            return is_stopping_ || is_merge_requested_;
+        });
+        if (is_stopping_) {
+            return;
+        }
+        is_merge_requested_ = false;
+        is_merge_running_ = true;
+        lock.unlock();
+        RunMerges();
+        lock.lock();
+        is_merge_running_ = false;
+        merge_done_cv_.notify_all();
+    }
+}
+
+void SegmentedSearchServer::RunMerges() {
+    while (true) {
+        std::vector<std::shared_ptr<Segment>> inputs;
+        size_t level = 0;
+        {
+            const std::unique_lock lock(mutex_);
+            std::map<size_t, std::vector<std::shared_ptr<Segment>>> levels;
+            for (const auto& segment : sealed_segments_) {
+                if (!segment->is_merging) {
+                    levels[segment->level].push_back(segment);
+                }
+            }
+            for (auto& [segment_level, segments] : levels) {
+                if (segments.size() >= std::max<size_t>(options_.merge_factor, 2)) {
+                    inputs = std::move(segments);
+                    level = segment_level + 1;
+                    break;
+                }
+            }
+            if (inputs.empty()) {
+                return;
+            }
+            for (const auto& segment : inputs) {
+                segment->is_merging = true;
+            }
+        }
+        Merge(inputs, level);
+    }
+}
+
+void SegmentedSearchServer::ForceMerge() {
+    Flush();
+    WaitForMerges();
+    MergeAll();
+}
+
+void SegmentedSearchServer::MergeAll() {
+    std::vector<std::shared_ptr<Segment>> inputs;
+    size_t level = 0;
+    {
+        const std::unique_lock lock(mutex_);
+        for (const auto& segment : sealed_segments_) {
+            if (!segment->is_merging) {
+                inputs.push_back(segment);
+                level = std::max(level, segment->level + 1);
+            }
+        }
+        if (inputs.size() < 2) {
+            return;
+        }
+        for (const auto& segment : inputs) {
+            segment->is_merging = true;
+        }
+    }
+    Merge(inputs, level);
+}
+
+void SegmentedSearchServer::Merge(const std::vector<std::shared_ptr<Segment>>& inputs, size_t level) {
+    // Входные сегменты не меняются, пока помечены is_merging, поэтому читаются без блокировки
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<const SearchServer*> sources;
+    for (const auto& segment : inputs) {
+        sources.push_back(&segment->index);
+    }
+    SearchServer merged(stop_words_);
+    merged.AddDocumentsFrom(sources);
+    merged.SetPostingsFormat(options_.sealed_postings_format);
+    merged.SetCompactionThreshold(1.0);
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+
+    const std::unique_lock lock(mutex_);
+    std::vector<int> deleted_ids;
+    for (const auto& input : inputs) {
+        deleted_ids.insert(deleted_ids.end(), input->pending_deletes.begin(), input->pending_deletes.end());
+    }
+    for (const int document_id : deleted_ids) {
+        for (const auto& [word, term_freq] : merged.GetWordFrequencies(document_id)) {
+            const auto it = pending_document_freqs_.find(word);
+            if (--it->second == 0) {
+                pending_document_freqs_.erase(it);
+            }
+        }
+    }
+    merged.RemoveDocuments(deleted_ids);
+    for (const auto& input : inputs) {
+        sealed_segments_.erase(std::find(sealed_segments_.begin(), sealed_segments_.end(), input));
+    }
+    merged_document_count_ += merged.GetDocumentCount() + deleted_ids.size();
+    if (merged.GetDocumentCount() > 0) {
+        sealed_segments_.push_back(std::make_shared<Segment>(std::move(merged), level));
+    }
+    ++merge_count_;
+    merge_seconds_ += duration.count();
+}
+
+SegmentedIndexStats SegmentedSearchServer::GetStats() const {
+    const std::shared_lock lock(mutex_);
+    SegmentedIndexStats stats;
+    stats.sealed_segment_count = sealed_segments_.size();
+    stats.mutable_document_count = mutable_segment_->GetDocumentCount();
+    stats.seal_count = seal_count_;
+    stats.merge_count = merge_count_;
+    stats.merged_document_count = merged_document_count_;
+    stats.merge_seconds = merge_seconds_;
+    ForEachSegment([&stats](const SearchServer& segment) {
+        stats.postings_memory_usage += segment.GetPostingsMemoryUsage();
+    });
+    return stats;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <execution>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+struct SegmentedIndexOptions {
+    // Изменяемый сегмент запечатывается, когда в нём набирается столько документов
+    size_t max_mutable_documents = 4096;
+
+    // Сегменты одного уровня сливаются в один сегмент следующего уровня, когда их набирается merge_factor
+    size_t merge_factor = 4;
+
+    // Слияния выполняются в фоновом потоке; иначе — синхронно после запечатывания
+    bool background_merge = true;
+
+    PostingsFormat sealed_postings_format = PostingsFormat::COMPRESSED;
+};
+
+struct SegmentedIndexStats {
+    size_t sealed_segment_count = 0;
+
+    size_t mutable_document_count = 0;
+
+    // Сколько раз изменяемый сегмент был запечатан
+    uint64_t seal_count = 0;
+
+    uint64_t merge_count = 0;
+
+    // Сколько документов было переписано слияниями
+    uint64_t merged_document_count = 0;
+
+    double merge_seconds = 0.0;
+
+    size_t postings_memory_usage = 0;
+};
+
+// Индекс из небольшого изменяемого сегмента, принимающего новые документы, и запечатанных
+// сегментов со сжатыми списками вхождений. Запрос выполняется по всем сегментам с общей
+// для них IDF, поэтому результаты совпадают с результатами одного SearchServer.
+// Запечатанные сегменты только помечают удалённые документы; физически документы
+// убираются при слиянии. Методы можно вызывать из разных потоков
+class SegmentedSearchServer {
+public:
+    using MatchResult = std::tuple<std::vector<std::string>, DocumentStatus>;
+
+    template <typename StringContainer>
+    explicit SegmentedSearchServer(const StringContainer& stop_words, const SegmentedIndexOptions& options = {});
+
+    explicit SegmentedSearchServer(const std::string& stop_words_text, const SegmentedIndexOptions& options = {});
+
+    explicit SegmentedSearchServer(std::string_view stop_words_text, const SegmentedIndexOptions& options = {});
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    // Дожидается завершения текущего слияния
+    ~SegmentedSearchServer();
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Выбрасывает std::out_of_range, если документа нет
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Слова копируются: после выхода из метода сегмент может быть слит и освобождён
+    MatchResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    // Запечатывает изменяемый сегмент, даже если он не заполнен
+    void Flush();
+
+    // Дожидается, пока не останется слияний, которые нужно выполнить по политике
+    void WaitForMerges();
+
+    // Запечатывает изменяемый сегмент и сливает все запечатанные сегменты в один
+    void ForceMerge();
+
+    SegmentedIndexStats GetStats() const;
+
+private:
+    struct Segment {
+        SearchServer index;
+
+        size_t level;
+
+        bool is_merging = false;
+
+        // Удаления, сделанные во время слияния: применяются к его результату, а до этого
+        // такие документы отфильтровываются запросами к этому сегменту
+        std::unordered_set<int> pending_deletes;
+
+        Segment(SearchServer index, size_t level);
+    };
+
+    const std::vector<std::string> stop_words_;
+
+    const SegmentedIndexOptions options_;
+
+    // Защищает набор сегментов и их содержимое; запросы берут его на чтение
+    mutable std::shared_mutex mutex_;
+
+    std::unique_ptr<SearchServer> mutable_segment_;
+
+    std::vector<std::shared_ptr<Segment>> sealed_segments_;
+
+    std::set<int> document_ids_;
+
+    // Слова документов, удалённых из сливающихся сегментов: вычитаются из частот до конца слияния
+    std::map<std::string, int, std::less<>> pending_document_freqs_;
+
+    uint64_t seal_count_ = 0;
+
+    uint64_t merge_count_ = 0;
+
+    uint64_t merged_document_count_ = 0;
+
+    double merge_seconds_ = 0.0;
+
+    // Состояние фонового потока слияний
+    std::mutex merge_mutex_;
+
+    std::condition_variable merge_requested_cv_;
+
+    std::condition_variable merge_done_cv_;
+
+    bool is_merge_requested_ = false;
+
+    bool is_merge_running_ = false;
+
+    bool is_stopping_ = false;
+
+    std::thread merge_thread_;
+
+    std::unique_ptr<SearchServer> MakeMutableSegment() const;
+
+    void Seal();
+
+    void RequestMerge();
+
+    void RunMergeLoop();
+
+    // Выполняет слияния по политике, пока они есть
+    void RunMerges();
+
+    // Сливает все запечатанные сегменты, которые не сливаются в другом потоке
+    void MergeAll();
+
+    void Merge(const std::vector<std::shared_ptr<Segment>>& inputs, size_t level);
+
+    InverseDocumentFreqs ComputeInverseDocumentFreqs(std::string_view raw_query) const;
+
+    template <typename Visitor>
+    void ForEachSegment(Visitor visitor) const;
+};
+
+template <typename StringContainer>
+SegmentedSearchServer::SegmentedSearchServer(const StringContainer& stop_words, const SegmentedIndexOptions& options)
+        : stop_words_(stop_words.begin(), stop_words.end()),
+          options_(options),
+          mutable_segment_(MakeMutableSegment()) {
+    if (options_.background_merge) {
+        merge_thread_ = std::thread([this] {
+            RunMergeLoop();
+        });
+    }
+}
+
+template <typename Visitor>
+void SegmentedSearchServer::ForEachSegment(Visitor visitor) const {
+    visitor(*mutable_segment_);
+    for (const auto& segment : sealed_segments_) {
+        visitor(segment->index);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                              size_t max_result_count) const {
+    const std::shared_lock lock(mutex_);
+    const InverseDocumentFreqs inverse_document_freqs = ComputeInverseDocumentFreqs(raw_query);
+    // Id удалённого во время слияния документа мог быть добавлен заново в другой сегмент,
+    // поэтому удаления фильтруются только в своём сегменте
+    const std::unordered_set<int> no_pending_deletes;
+    std::vector<std::pair<const SearchServer*, const std::unordered_set<int>*>> segments;
+    segments.emplace_back(mutable_segment_.get(), &no_pending_deletes);
+    for (const auto& segment : sealed_segments_) {
+        segments.emplace_back(&segment->index, &segment->pending_deletes);
+    }
+    std::vector<std::vector<Document>> segment_documents(segments.size());
+    std::transform(std::execution::par, segments.begin(), segments.end(), segment_documents.begin(),
+                   [&](const auto& segment) {
+                       const auto& [index, pending_deletes] = segment;
+                       if (pending_deletes->empty()) {
+                           return index->FindTopDocuments(std::execution::seq, raw_query, document_predicate,
+                                                          max_result_count, inverse_document_freqs);
+                       }
+                       const auto accepts = [&](int document_id, DocumentStatus status, int rating) {
+                           return pending_deletes->count(document_id) == 0 && document_predicate(document_id, status, rating);
+                       };
+                       return index->FindTopDocuments(std::execution::seq, raw_query, accepts, max_result_count,
+                                                      inverse_document_freqs);
+                   });
+    TopDocuments top_documents(max_result_count);
+    for (const auto& documents : segment_documents) {
+        for (const Document& document : documents) {
+            top_documents.Push(document);
+        }
+    }
+    return top_documents.Extract();
+}
@@ -0,0 +1,187 @@
+#include "sharded_search_server.h"
+
+#include <cstdint>
+#include <exception>
+#include <numeric>
+
+using namespace std::string_literals;
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, size_t shard_count)
+        : ShardedSearchServer(std::string_view(stop_words_text), shard_count) {}
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text, size_t shard_count)
+        : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count) {}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // Перемешивание, чтобы id с общим шагом не попадали в один шард
+    const uint64_t hash = static_cast<uint32_t>(document_id) * 0x9e3779b97f4a7c15ULL;
+    return (hash >> 32) % shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    const SearchServer& shard = shards_[GetShardIndex(document_id)];
+    if (!shard.ContainsDocument(document_id)) {
+        throw std::out_of_range("Document "s + std::to_string(document_id) + " not found"s);
+    }
+    return shard;
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return const_cast<SearchServer&>(static_cast<const ShardedSearchServer&>(*this).GetShard(document_id));
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    // Одинаковые id попадают в один шард, поэтому проверки шарда достаточно
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    std::vector<char> is_valid_text(documents.size());
+    std::transform(std::execution::par, documents.begin(), documents.end(), is_valid_text.begin(),
+                   [](const DocumentInput& document) {
+                       // Та же проверка управляющих символов, что и при разборе документа в SearchServer
+                       thread_local std::vector<std::string_view> words;
+                       return SplitIntoWords(document.text, words) == std::string_view::npos;
+                   });
+    // Добавляется только префикс до первого некорректного документа
+    std::set<int> batch_ids;
+    size_t accepted_count = 0;
+    for (; accepted_count < documents.size(); ++accepted_count) {
+        const int document_id = documents[accepted_count].id;
+        if (document_id < 0 || !is_valid_text[accepted_count] || document_ids_.count(document_id) > 0
+            || !batch_ids.insert(document_id).second) {
+            break;
+        }
+    }
+    std::vector<std::vector<DocumentInput>> shard_documents(shards_.size());
+    for (size_t index = 0; index < accepted_count; ++index) {
+        shard_documents[GetShardIndex(documents[index].id)].push_back(documents[index]);
+    }
+    std::vector<size_t> shard_indexes(shards_.size());
+    std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+    std::for_each(std::execution::par, shard_indexes.begin(), shard_indexes.end(), [&](size_t shard_index) {
+        shards_[shard_index].AddDocuments(shard_documents[shard_index]);
+    });
+    document_ids_.insert(batch_ids.begin(), batch_ids.end());
+    if (accepted_count < documents.size()) {
+        // Шард выбрасывает то же исключение, что и один SearchServer на этом документе
+        const DocumentInput& document = documents[accepted_count];
+        if (document.id >= 0 && batch_ids.count(document.id) > 0) {
+            throw std::invalid_argument("Invalid document_id"s);
+        }
+        AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                            size_t max_result_count) const {
+    return FindTopDocuments(std::execution::par, raw_query, status, max_result_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+InverseDocumentFreqs ShardedSearchServer::ComputeInverseDocumentFreqs(std::string_view raw_query) const {
+    // Все шарды разбирают запрос одинаково, поэтому списки слов совпадают по порядку
+    auto document_freqs = shards_.front().GetQueryDocumentFreqs(raw_query);
+    for (size_t shard_index = 1; shard_index < shards_.size(); ++shard_index) {
+        const auto shard_document_freqs = shards_[shard_index].GetQueryDocumentFreqs(raw_query);
+        for (size_t i = 0; i < document_freqs.size(); ++i) {
+            document_freqs[i].second += shard_document_freqs[i].second;
+        }
+    }
+    InverseDocumentFreqs inverse_document_freqs;
+    const int document_count = GetDocumentCount();
+    for (const auto& [word, document_freq] : document_freqs) {
+        inverse_document_freqs.emplace(word, SearchServer::ComputeInverseDocumentFreq(document_count, document_freq));
+    }
+    return inverse_document_freqs;
+}
+
+std::vector<Document> ShardedSearchServer::MergeTopDocuments(const std::vector<std::vector<Document>>& shard_documents,
+                                                             size_t max_result_count) {
+    TopDocuments top_documents(max_result_count);
+    for (const auto& documents : shard_documents) {
+        for (const Document& document : documents) {
+            top_documents.Push(document);
+        }
+    }
+    return top_documents.Extract();
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(document_ids_.size());
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+typename std::set<int>::const_iterator ShardedSearchServer::begin() const {
+    return document_ids_.begin();
+}
+
+typename std::set<int>::const_iterator ShardedSearchServer::end() const {
+    return document_ids_.end();
+}
+
+const std::map<std::string_view, double>& ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void ShardedSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    std::vector<std::vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids) {
+        GetShard(document_id);
+        shard_document_ids[GetShardIndex(document_id)].push_back(document_id);
+    }
+    std::vector<size_t> shard_indexes(shards_.size());
+    std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+    std::for_each(std::execution::par, shard_indexes.begin(), shard_indexes.end(), [&](size_t shard_index) {
+        shards_[shard_index].RemoveDocuments(shard_document_ids[shard_index]);
+    });
+    for (const int document_id : document_ids) {
+        document_ids_.erase(document_id);
+    }
+}
+
+void ShardedSearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id) {
+    GetShard(document_id).RemoveDocument(policy, document_id);
+    document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id) {
+    GetShard(document_id).RemoveDocument(policy, document_id);
+    document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::UpdateDocumentStatus(int document_id, DocumentStatus status) {
+    GetShard(document_id).UpdateDocumentStatus(document_id, status);
+}
+
+void ShardedSearchServer::UpdateDocumentRating(int document_id, const std::vector<int>& ratings) {
+    GetShard(document_id).UpdateDocumentRating(document_id, ratings);
+}
+
+void ShardedSearchServer::UpdateDocument(int document_id, std::string_view document) {
+    GetShard(document_id).UpdateDocument(document_id, document);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::execution::sequenced_policy& policy, std::string_view raw_query, int document_id) const {
+    return GetShard(document_id).MatchDocument(policy, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const {
+    return GetShard(document_id).MatchDocument(policy, raw_query, document_id);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+#include <algorithm>
+#include <deque>
+#include <execution>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Индекс, разбитый на независимые SearchServer по хешу id документа. Шарды заполняются
+// и опрашиваются параллельно; лучшие документы шардов сливаются в общий результат.
+// Релевантность считается по общей для всех шардов IDF, поэтому результаты совпадают
+// с результатами одного SearchServer с теми же документами
+class ShardedSearchServer {
+public:
+    // shard_count = 0 — по числу аппаратных потоков
+    template <typename StringContainer>
+    explicit ShardedSearchServer(const StringContainer& stop_words, size_t shard_count = 0);
+
+    explicit ShardedSearchServer(const std::string& stop_words_text, size_t shard_count = 0);
+
+    explicit ShardedSearchServer(std::string_view stop_words_text, size_t shard_count = 0);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Шарды добавляют свои документы параллельно. Если какой-то документ некорректен,
+    // все предшествующие ему документы остаются добавленными и выбрасывается то же
+    // исключение, что и у AddDocument
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+
+    // Без политики шарды опрашиваются параллельно
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+    typename std::set<int>::const_iterator begin() const;
+
+    typename std::set<int>::const_iterator end() const;
+
+    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    // Шарды удаляют свои документы параллельно. Если какого-то id нет,
+    // выбрасывает std::out_of_range и ничего не удаляет
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    void RemoveDocument(const std::execution::sequenced_policy& policy, int document_id);
+
+    void RemoveDocument(const std::execution::parallel_policy& policy, int document_id);
+
+    void UpdateDocumentStatus(int document_id, DocumentStatus status);
+
+    void UpdateDocumentRating(int document_id, const std::vector<int>& ratings);
+
+    void UpdateDocument(int document_id, std::string_view document);
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy& policy, std::string_view raw_query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const;
+
+private:
+    // deque не перемещает шарды при добавлении: SearchServer нельзя копировать
+    std::deque<SearchServer> shards_;
+
+    std::set<int> document_ids_;
+
+    template <typename StringContainer>
+    static std::deque<SearchServer> MakeShards(const StringContainer& stop_words, size_t shard_count);
+
+    size_t GetShardIndex(int document_id) const;
+
+    // Выбрасывает std::out_of_range, если документа нет
+    const SearchServer& GetShard(int document_id) const;
+
+    SearchServer& GetShard(int document_id);
+
+    InverseDocumentFreqs ComputeInverseDocumentFreqs(std::string_view raw_query) const;
+
+    static std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& shard_documents,
+                                                   size_t max_result_count);
+};
+
+template <typename StringContainer>
+std::deque<SearchServer> ShardedSearchServer::MakeShards(const StringContainer& stop_words, size_t shard_count) {
+    if (shard_count == 0) {
+        shard_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::deque<SearchServer> shards;
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.emplace_back(stop_words);
+    }
+    return shards;
+}
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words, size_t shard_count)
+        : shards_(MakeShards(stop_words, shard_count)) {}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                            size_t max_result_count) const {
+    return FindTopDocuments(std::execution::par, raw_query, document_predicate, max_result_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query,
+                                                            DocumentPredicate document_predicate, size_t max_result_count) const {
+    const InverseDocumentFreqs inverse_document_freqs = ComputeInverseDocumentFreqs(raw_query);
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    std::transform(policy, shards_.begin(), shards_.end(), shard_documents.begin(), [&](const SearchServer& shard) {
+        return shard.FindTopDocuments(std::execution::seq, raw_query, document_predicate, max_result_count, inverse_document_freqs);
+    });
+    return MergeTopDocuments(shard_documents, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query,
+                                                            DocumentStatus status, size_t max_result_count) const {
+    const InverseDocumentFreqs inverse_document_freqs = ComputeInverseDocumentFreqs(raw_query);
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    std::transform(policy, shards_.begin(), shards_.end(), shard_documents.begin(), [&](const SearchServer& shard) {
+        return shard.FindTopDocuments(std::execution::seq, raw_query, status, max_result_count, inverse_document_freqs);
+    });
+    return MergeTopDocuments(shard_documents, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
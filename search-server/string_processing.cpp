@@ -1,13 +1,191 @@
 #include "string_processing.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_SERVER_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Переводит маски пробелов и управляющих символов блока текста в границы слов.
+// Бит i маски соответствует байту offset + i
+class WordScanner {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    WordScanner(std::string_view text, std::vector<std::string_view>& words)
+            : text_(text), words_(words) {
+        words_.clear();
+    }
+
+    std::string_view GetText() const {
+        return text_;
+    }
+
+    void ProcessBlock(size_t offset, uint64_t space_mask, uint64_t control_mask, size_t width) {
+        if (control_mask != 0 && first_control_ == std::string_view::npos) {
+            first_control_ = offset + __builtin_ctzll(control_mask);
+        }
+        const uint64_t width_mask = width == BLOCK_SIZE ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+        uint64_t boundaries = (space_mask ^ ((space_mask << 1) | previous_space_)) & width_mask;
+        previous_space_ = (space_mask >> (width - 1)) & 1;
+        while (boundaries != 0) {
+            const size_t i = __builtin_ctzll(boundaries);
+            if ((space_mask >> i) & 1) {
+                words_.push_back(text_.substr(word_start_, offset + i - word_start_));
+            } else {
+                word_start_ = offset + i;
+            }
+            boundaries &= boundaries - 1;
+        }
+    }
+
+    // Побайтово обрабатывает текст начиная с offset
+    void ProcessTail(size_t offset) {
+        while (offset < text_.size()) {
+            const size_t width = std::min(BLOCK_SIZE, text_.size() - offset);
+            uint64_t space_mask = 0;
+            uint64_t control_mask = 0;
+            for (size_t i = 0; i < width; ++i) {
+                const auto c = static_cast<unsigned char>(text_[offset + i]);
+                space_mask |= uint64_t{c == ' '} << i;
+                control_mask |= uint64_t{c < ' '} << i;
+            }
+            ProcessBlock(offset, space_mask, control_mask, width);
+            offset += width;
+        }
+    }
+
+    size_t Finish() {
+        if (!previous_space_) {
+            words_.push_back(text_.substr(word_start_));
+        }
+        return first_control_;
+    }
+
+private:
+    std::string_view text_;
+    std::vector<std::string_view>& words_;
+    size_t word_start_ = 0;
+    uint64_t previous_space_ = 1;
+    size_t first_control_ = std::string_view::npos;
+};
+
+size_t SplitScalar(WordScanner& scanner) {
+    scanner.ProcessTail(0);
+    return scanner.Finish();
+}
+
+#ifdef SEARCH_SERVER_X86_SIMD
+
+size_t SplitSse2(WordScanner& scanner) {
+    const std::string_view text = scanner.GetText();
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(0x1F);
+    size_t offset = 0;
+    for (; offset + WordScanner::BLOCK_SIZE <= text.size(); offset += WordScanner::BLOCK_SIZE) {
+        uint64_t space_mask = 0;
+        uint64_t control_mask = 0;
+        for (size_t part = 0; part < WordScanner::BLOCK_SIZE; part += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + offset + part));
+            const uint64_t part_spaces = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, spaces)));
+            // Беззнаковое сравнение c <= 0x1F через max(c, 0x1F) == 0x1F
+            const uint64_t part_controls = static_cast<uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, last_control), last_control)));
+            space_mask |= part_spaces << part;
+            control_mask |= part_controls << part;
+        }
+        scanner.ProcessBlock(offset, space_mask, control_mask, WordScanner::BLOCK_SIZE);
+    }
+    scanner.ProcessTail(offset);
+    return scanner.Finish();
+}
+
+__attribute__((target("avx2")))
+size_t SplitAvx2(WordScanner& scanner) {
+    const std::string_view text = scanner.GetText();
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(0x1F);
+    size_t offset = 0;
+    for (; offset + WordScanner::BLOCK_SIZE <= text.size(); offset += WordScanner::BLOCK_SIZE) {
+        const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + offset));
+        const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + offset + 32));
+        const uint64_t space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, spaces)))
+                                    | uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, spaces)))} << 32;
+        const uint64_t control_mask =
+                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(low, last_control), last_control)))
+                | uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(high, last_control), last_control)))} << 32;
+        scanner.ProcessBlock(offset, space_mask, control_mask, WordScanner::BLOCK_SIZE);
+    }
+    scanner.ProcessTail(offset);
+    return scanner.Finish();
+}
+
+#endif
+
+using SplitFunction = size_t (*)(WordScanner&);
+
+SplitFunction GetSplitFunction(SplitImplementation implementation) {
+    switch (implementation) {
+#ifdef SEARCH_SERVER_X86_SIMD
+        case SplitImplementation::SSE2:
+            return SplitSse2;
+        case SplitImplementation::AVX2:
+            return SplitAvx2;
+#endif
+        case SplitImplementation::SCALAR:
+            return SplitScalar;
+        default:
+            return nullptr;
+    }
+}
+
+SplitImplementation SelectBestSplitImplementation() {
+    for (SplitImplementation implementation : {SplitImplementation::AVX2, SplitImplementation::SSE2}) {
+        if (IsSplitImplementationSupported(implementation)) {
+            return implementation;
+        }
+    }
+    return SplitImplementation::SCALAR;
+}
+
+}  // namespace
+
+bool IsSplitImplementationSupported(SplitImplementation implementation) {
+    switch (implementation) {
+        case SplitImplementation::AUTO:
+        case SplitImplementation::SCALAR:
+            return true;
+#ifdef SEARCH_SERVER_X86_SIMD
+        case SplitImplementation::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case SplitImplementation::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
 std::vector<std::string_view> SplitIntoWords(std::string_view str) {
     std::vector<std::string_view> result;
-    auto pos = str.find_first_not_of(' ');
-    const auto pos_end = str.npos;
-    while (pos != pos_end) {
-        auto space = str.find(' ', pos);
-        result.push_back(space == pos_end ? str.substr(pos) : str.substr(pos, space - pos));
-        pos = str.find_first_not_of(' ', space);
-    }
+    SplitIntoWords(str, result);
     return result;
-}
\ No newline at end of file
+}
+
+size_t SplitIntoWords(std::string_view text, std::vector<std::string_view>& words, SplitImplementation implementation) {
+    static const SplitFunction best_split = GetSplitFunction(SelectBestSplitImplementation());
+    SplitFunction split = best_split;
+    if (implementation != SplitImplementation::AUTO) {
+        if (!IsSplitImplementationSupported(implementation)) {
+            throw std::invalid_argument("Split implementation is not supported by this processor");
+        }
+        split = GetSplitFunction(implementation);
+    }
+    WordScanner scanner(text, words);
+    return split(scanner);
+}
@@ -16,4 +16,20 @@ std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContain
     return non_empty_strings;
 }
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text);
\ No newline at end of file
+// Реализация разбиения на слова; AUTO выбирает лучшую из поддерживаемых процессором
+enum class SplitImplementation {
+    AUTO,
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+bool IsSplitImplementationSupported(SplitImplementation implementation);
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// Разбивает text на слова за один проход, записывая их в переиспользуемый буфер words
+// (прежнее содержимое удаляется). Возвращает позицию первого управляющего символа
+// (0x00-0x1F) в text или std::string_view::npos, если таких символов нет
+size_t SplitIntoWords(std::string_view text, std::vector<std::string_view>& words,
+                      SplitImplementation implementation = SplitImplementation::AUTO);
@@ -13,6 +13,46 @@ void AssertImpl(bool value, const std::string& expr_str, const std::string& file
     }
 }
 
+namespace {
+
+// Добавляет документы 1, 2 и 3, релевантности которых по запросу "a b" попарно отличаются примерно
+// на EPSILON: 3 лучше 1 по релевантности, а 2 лучше 3 и 1 лучше 2 по рейтингу. Сравнение нетранзитивно,
+// поэтому лучший документ зависит от порядка отбора; все режимы поиска отбирают по возрастанию
+// порядкового номера и возвращают документ 3. Вокруг них добавляются однословные документы
+void AddNearTieDocuments(SearchServer& server, int leading_filler_count = 7, int trailing_filler_count = 0) {
+    const int document_count = leading_filler_count + trailing_filler_count + 3;
+    const double b_inverse_document_freq = std::log(document_count / 3.0);
+    const double ab_inverse_document_freq = std::log(document_count) + b_inverse_document_freq;
+    // Документы 1 и 2 из слова b и заполнителей отличаются длиной на одно слово, что меняет
+    // релевантность примерно на 0.9 * EPSILON; документ 3 сильнее документа 2 примерно на 0.5 * EPSILON
+    const int length_1 = static_cast<int>(std::sqrt(b_inverse_document_freq / (0.9 * EPSILON)));
+    const int length_3 = static_cast<int>(ab_inverse_document_freq / (b_inverse_document_freq / (length_1 - 1) + 0.5 * EPSILON));
+    const auto fillers = [](int count) {
+        std::string text;
+        for (int i = 0; i < count; ++i) {
+            text += " f"s;
+        }
+        return text;
+    };
+    int filler_id = 100;
+    for (int i = 0; i < leading_filler_count; ++i) {
+        server.AddDocument(filler_id++, "z"s, DocumentStatus::ACTUAL, {0});
+    }
+    server.AddDocument(1, "b"s + fillers(length_1 - 1), DocumentStatus::ACTUAL, {3});
+    server.AddDocument(2, "b"s + fillers(length_1 - 2), DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "a b"s + fillers(length_3 - 2), DocumentStatus::ACTUAL, {1});
+    for (int i = 0; i < trailing_filler_count; ++i) {
+        server.AddDocument(filler_id++, "z"s, DocumentStatus::ACTUAL, {0});
+    }
+    std::map<int, Document> found;
+    for (const Document& document : server.FindTopDocuments("a b"s, DocumentStatus::ACTUAL, 3)) {
+        found[document.id] = document;
+    }
+    ASSERT(IsBetterDocument(found[3], found[1]) && IsBetterDocument(found[2], found[3]) && IsBetterDocument(found[1], found[2]));
+}
+
+}  // namespace
+
 // Тест проверяет, что поисковая система исключает стоп-слова при добавлении документов
 void TestExcludeStopWordsFromAddedDocumentContent() {
     const int doc_id = 42;
@@ -70,7 +110,7 @@ void TestMinusWords() {
 //Матчинг документов. При матчинге документа по поисковому запросу должны быть возвращены все слова из поискового запроса, присутствующие в документе. Если есть соответствие хотя бы по одному минус-слову, должен возвращаться пустой список слов.
 void TestMatching() {
     SearchServer server("in the"s);
-    const std::vector<std::string_view> test_words = {"black"s, "dog"s};
+    const std::vector<std::string_view> test_words = {"black", "dog"};
     server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
     const auto [words, status] = server.MatchDocument("-cat in city"s, 1);
     ASSERT_EQUAL_HINT(static_cast<int>(words.size()), 0, "Document contains minus-word!"s);
@@ -159,6 +199,1317 @@ void TestComputeRelevance() {
     ASSERT_HINT(std::abs(doc0.relevance - (log(server.GetDocumentCount() * 1.0 / 1) * (2.0 / 4))) < EPSILON, "Relevance is compute incorrectly!"s);
 }
 
+//Удаление документов. Удалённый документ не должен находиться поиском, а его частоты слов должны быть пустыми.
+void TestRemoveDocument() {
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(2, "dog in the city"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "white cat"s, DocumentStatus::ACTUAL, {4});
+    ASSERT_EQUAL(static_cast<int>(server.GetWordFrequencies(1).size()), 2);
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT(server.GetWordFrequencies(1).empty());
+    const auto found_docs = server.FindTopDocuments("cat city"s);
+    ASSERT_EQUAL(static_cast<int>(found_docs.size()), 2);
+    for (const Document& document : found_docs) {
+        ASSERT_HINT(document.id != 1, "Removed document was found!"s);
+    }
+    const auto city_docs = server.FindTopDocuments("city"s);
+    ASSERT_EQUAL(static_cast<int>(city_docs.size()), 1);
+    ASSERT_HINT(std::abs(city_docs[0].relevance - log(2.0 / 1) * 0.5) < EPSILON, "IDF is not updated after removal!"s);
+    server.RemoveDocument(std::execution::par, 3);
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(static_cast<int>(server.FindTopDocuments(std::execution::par, "city"s).size()), 1);
+}
+
+//Таблица документов. Номера выдаются по возрастанию и не переиспользуются, удалённый документ не находится по id, Compact нумерует живые документы подряд.
+void TestDocumentTable() {
+    DocumentTable table;
+    ASSERT_EQUAL(table.Add(10, 1, DocumentStatus::ACTUAL, 0.5), 0);
+    ASSERT_EQUAL(table.Add(5, 2, DocumentStatus::BANNED, 0.25), 1);
+    ASSERT_EQUAL(table.Add(7, 3, DocumentStatus::ACTUAL, 1.0), 2);
+    ASSERT_EQUAL(table.GetOrdinal(5), 1);
+    ASSERT_EQUAL(table.GetDocumentId(2), 7);
+    ASSERT_EQUAL(table.GetRating(1), 2);
+    ASSERT(table.GetStatus(1) == DocumentStatus::BANNED);
+    ASSERT_EQUAL(table.GetInvWordCount(0), 0.5);
+    ASSERT(table.GetStatusBitmap(DocumentStatus::BANNED).Test(1));
+
+    table.Remove(1);
+    ASSERT(!table.Contains(5));
+    ASSERT_EQUAL(table.FindOrdinal(5), -1);
+    try {
+        table.GetOrdinal(5);
+        ASSERT_HINT(false, "Removed id must throw"s);
+    } catch (const std::out_of_range&) {
+    }
+    ASSERT(!table.IsAlive(1));
+    ASSERT(!table.GetStatusBitmap(DocumentStatus::BANNED).Test(1));
+    ASSERT_EQUAL(table.GetLiveCount(), 2);
+    ASSERT_EQUAL(table.GetTombstoneCount(), 1);
+
+    //Описание: повторно добавленный id получает новый номер, номер удалённого документа не переиспользуется
+    ASSERT_EQUAL(table.Add(5, 4, DocumentStatus::ACTUAL, 0.125), 3);
+    ASSERT_EQUAL(table.GetOrdinal(5), 3);
+    ASSERT_EQUAL(table.GetOrdinalCount(), 4);
+    ASSERT_EQUAL(table.GetDocumentId(1), 5);
+    ASSERT(!table.IsAlive(1));
+
+    const std::vector<int> new_ordinals = table.Compact();
+    ASSERT(new_ordinals == std::vector<int>({0, -1, 1, 2}));
+    ASSERT_EQUAL(table.GetOrdinalCount(), 3);
+    ASSERT_EQUAL(table.GetTombstoneCount(), 0);
+    ASSERT_EQUAL(table.GetOrdinal(10), 0);
+    ASSERT_EQUAL(table.GetOrdinal(7), 1);
+    ASSERT_EQUAL(table.GetOrdinal(5), 2);
+    ASSERT_EQUAL(table.GetRating(2), 4);
+    ASSERT(table.GetStatusBitmap(DocumentStatus::ACTUAL).Test(2));
+    ASSERT(!table.GetStatusBitmap(DocumentStatus::BANNED).Test(1));
+
+    //Описание: документы сервера перечисляются по возрастанию id независимо от порядка добавления и удалений
+    SearchServer server(""s);
+    for (const int document_id : {8, 3, 11, 1}) {
+        server.AddDocument(document_id, "cat"s, DocumentStatus::ACTUAL, {1});
+    }
+    server.RemoveDocument(3);
+    server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {1});
+    server.RemoveDocument(11);
+    ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>({1, 3, 8}));
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 1u);
+}
+
+//Кэшированные логарифмы частот. Релевантность после любых изменений индекса равна log(N / df) * tf, посчитанной заново.
+void TestCachedInverseDocumentFreq() {
+    SearchServer server(""s);
+    std::map<int, std::vector<std::string>> documents;
+    const std::vector<std::string> query_words = {"cat"s, "dog"s, "city"s};
+    const auto check = [&](const std::string& stage) {
+        ASSERT_EQUAL(server.GetDocumentCount(), static_cast<int>(documents.size()));
+        std::map<std::string, int> document_freqs;
+        for (const auto& [document_id, words] : documents) {
+            for (const std::string& word : std::set<std::string>(words.begin(), words.end())) {
+                ++document_freqs[word];
+            }
+        }
+        const auto found = server.FindTopDocuments("cat dog city"s, DocumentStatus::ACTUAL, documents.size() + 1);
+        for (const Document& document : found) {
+            const auto& words = documents.at(document.id);
+            double expected_relevance = 0.0;
+            for (const std::string& query_word : query_words) {
+                const auto term_count = std::count(words.begin(), words.end(), query_word);
+                if (term_count > 0) {
+                    expected_relevance += log(documents.size() * 1.0 / document_freqs[query_word]) * term_count / words.size();
+                }
+            }
+            ASSERT_HINT(std::abs(document.relevance - expected_relevance) < 1e-12, "Stale IDF after "s + stage);
+        }
+    };
+    const auto add = [&](int document_id, const std::vector<std::string>& words) {
+        std::string text;
+        for (const std::string& word : words) {
+            text += word + " "s;
+        }
+        server.AddDocument(document_id, text, DocumentStatus::ACTUAL, {1});
+        documents[document_id] = words;
+    };
+    add(1, {"cat"s, "in"s, "city"s});
+    add(2, {"dog"s, "dog"s, "city"s});
+    add(3, {"white"s, "cat"s});
+    check("AddDocument"s);
+    server.RemoveDocument(2);
+    documents.erase(2);
+    check("RemoveDocument"s);
+    const std::vector<std::string> texts = {"dog city"s, "cat cat dog"s, "old city"s, "bird"s};
+    std::vector<DocumentInput> batch;
+    for (int i = 0; i < static_cast<int>(texts.size()); ++i) {
+        batch.push_back({10 + i, texts[i], DocumentStatus::ACTUAL, {1}});
+        for (std::string_view word : SplitIntoWords(texts[i])) {
+            documents[10 + i].emplace_back(word);
+        }
+    }
+    server.AddDocuments(batch);
+    check("AddDocuments"s);
+    server.RemoveDocument(std::execution::par, 1);
+    documents.erase(1);
+    check("parallel RemoveDocument"s);
+}
+
+//Сжатый формат списков вхождений. Поиск по сжатому индексу должен давать те же результаты, что и по несжатому.
+void TestCompressedPostings() {
+    SearchServer plain_server("and"s);
+    SearchServer compressed_server("and"s);
+    compressed_server.SetPostingsFormat(PostingsFormat::COMPRESSED);
+    const std::vector<std::string> texts = {"cat and dog"s, "white cat"s, "black dog"s, "cat cat bird"s};
+    for (int i = 0; i < 1000; ++i) {
+        const int document_id = (i * 7919) % 1000;
+        const std::string& text = texts[document_id % texts.size()];
+        plain_server.AddDocument(document_id, text, DocumentStatus::ACTUAL, {document_id % 10});
+        compressed_server.AddDocument(document_id, text, DocumentStatus::ACTUAL, {document_id % 10});
+    }
+    for (int document_id = 0; document_id < 1000; document_id += 3) {
+        plain_server.RemoveDocument(document_id);
+        compressed_server.RemoveDocument(document_id);
+    }
+    ASSERT(compressed_server.GetPostingsMemoryUsage() < plain_server.GetPostingsMemoryUsage());
+    for (const std::string& query : {"cat"s, "dog -white"s, "bird black"s}) {
+        const auto plain_docs = plain_server.FindTopDocuments(query);
+        const auto compressed_docs = compressed_server.FindTopDocuments(query);
+        ASSERT_EQUAL(plain_docs.size(), compressed_docs.size());
+        for (size_t i = 0; i < plain_docs.size(); ++i) {
+            ASSERT_EQUAL(plain_docs[i].id, compressed_docs[i].id);
+            ASSERT(std::abs(plain_docs[i].relevance - compressed_docs[i].relevance) < EPSILON);
+        }
+    }
+    const auto [words, status] = compressed_server.MatchDocument("cat bird"s, 7);
+    ASSERT_EQUAL(static_cast<int>(words.size()), 2);
+    compressed_server.SetPostingsFormat(PostingsFormat::PLAIN);
+    ASSERT_EQUAL(compressed_server.FindTopDocuments("cat"s).front().id, plain_server.FindTopDocuments("cat"s).front().id);
+}
+
+//Ограничение количества результатов. Возвращается не больше заданного числа лучших документов в порядке убывания релевантности.
+void TestMaxResultCount() {
+    SearchServer server("and"s);
+    for (int document_id = 0; document_id < 20; ++document_id) {
+        const std::string text = "cat "s + std::string(document_id + 1, 'x');
+        server.AddDocument(document_id, text, DocumentStatus::ACTUAL, {document_id});
+    }
+    ASSERT_EQUAL(static_cast<int>(server.FindTopDocuments("cat"s).size()), MAX_RESULT_DOCUMENT_COUNT);
+    const auto top_3 = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 3);
+    const auto top_3_par = server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::ACTUAL, 3);
+    ASSERT_EQUAL(static_cast<int>(top_3.size()), 3);
+    ASSERT_EQUAL(static_cast<int>(top_3_par.size()), 3);
+    for (size_t i = 0; i < top_3.size(); ++i) {
+        ASSERT_EQUAL(top_3[i].rating, 19 - static_cast<int>(i));
+        ASSERT_EQUAL(top_3[i].id, top_3_par[i].id);
+    }
+    const auto all = server.FindTopDocuments("cat"s, [](int, DocumentStatus, int) { return true; }, 100);
+    ASSERT_EQUAL(static_cast<int>(all.size()), 20);
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 0).empty());
+
+    // Результат не зависит от порядка слов запроса
+    SearchServer near_tie_server(""s);
+    AddNearTieDocuments(near_tie_server);
+    for (const std::string& query : {"a b"s, "b a"s}) {
+        ASSERT_EQUAL(near_tie_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 1).front().id, 3);
+    }
+}
+
+//Пакетное добавление документов. Результат должен совпадать с последовательными вызовами AddDocument, включая обработку ошибок.
+void TestAddDocuments() {
+    SearchServer single_server("in the"s);
+    SearchServer batch_server("in the"s);
+    std::vector<DocumentInput> documents;
+    std::vector<std::string> texts;
+    for (int document_id = 0; document_id < 200; ++document_id) {
+        texts.push_back("cat "s + std::to_string(document_id % 7) + " in the city "s + std::to_string(document_id % 3));
+    }
+    for (int document_id = 0; document_id < 200; ++document_id) {
+        documents.push_back({document_id, texts[document_id], DocumentStatus::ACTUAL, {document_id % 5}});
+        single_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {document_id % 5});
+    }
+    batch_server.AddDocuments(documents);
+    ASSERT_EQUAL(batch_server.GetDocumentCount(), single_server.GetDocumentCount());
+    const auto single_docs = single_server.FindTopDocuments("cat 3 -1"s, DocumentStatus::ACTUAL, 50);
+    const auto batch_docs = batch_server.FindTopDocuments("cat 3 -1"s, DocumentStatus::ACTUAL, 50);
+    ASSERT_EQUAL(single_docs.size(), batch_docs.size());
+    for (size_t i = 0; i < single_docs.size(); ++i) {
+        ASSERT_EQUAL(single_docs[i].id, batch_docs[i].id);
+        ASSERT(std::abs(single_docs[i].relevance - batch_docs[i].relevance) < EPSILON);
+    }
+    ASSERT(batch_server.GetWordFrequencies(10) == single_server.GetWordFrequencies(10));
+
+    const std::string dog_text = "dog"s;
+    const std::string invalid_text = "dog\x12"s;
+    const std::string bird_text = "bird"s;
+    const std::vector<DocumentInput> invalid_documents = {
+            {300, dog_text, DocumentStatus::ACTUAL, {}},
+            {301, invalid_text, DocumentStatus::ACTUAL, {}},
+            {302, bird_text, DocumentStatus::ACTUAL, {}}};
+    try {
+        batch_server.AddDocuments(invalid_documents);
+        ASSERT_HINT(false, "Invalid word must be rejected!"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(batch_server.GetDocumentCount(), 201);
+    ASSERT_EQUAL(static_cast<int>(batch_server.FindTopDocuments("dog"s).size()), 1);
+    ASSERT(batch_server.FindTopDocuments("bird"s).empty());
+    try {
+        const std::string owl_text = "owl"s;
+        batch_server.AddDocuments({{400, owl_text, DocumentStatus::ACTUAL, {}}, {400, owl_text, DocumentStatus::ACTUAL, {}}});
+        ASSERT_HINT(false, "Duplicate id must be rejected!"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(batch_server.GetDocumentCount(), 202);
+}
+
+//Освобождение памяти слов. После удаления документов память их уникальных слов должна учитываться как освобождаемая и возвращаться при уплотнении.
+void TestCompactTextStore() {
+    SearchServer server("and"s);
+    server.SetCompactionThreshold(1.0);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "white parrot"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "black dog"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), 0u);
+    server.RemoveDocument(2);
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), "white"s.size() + "parrot"s.size());
+    server.RemoveDocument(std::execution::par, 1);
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), "white"s.size() + "parrot"s.size() + "cat"s.size());
+    server.AddDocument(4, "cat parrot"s, DocumentStatus::ACTUAL, {4});
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), "white"s.size());
+    server.CompactTextStore();
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), 0u);
+    ASSERT(server.FindTopDocuments("white"s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).front().id, 3);
+    const auto [words, status] = server.MatchDocument("cat parrot dog"s, 4);
+    ASSERT_EQUAL(static_cast<int>(words.size()), 2);
+    ASSERT_EQUAL(server.GetWordFrequencies(3).begin()->first, "black"s);
+    server.AddDocument(5, "white owl"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(server.FindTopDocuments("white"s).front().id, 5);
+}
+
+//Снимок индекса. Сервер, открытый из снимка, должен отвечать на запросы так же, как исходный.
+void TestIndexSnapshot() {
+    SearchServer server("and in"s);
+    server.AddDocument(5, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {5, -12, 2, 1});
+    server.AddDocument(2, "groomed starling eugene"s, DocumentStatus::ACTUAL, {9});
+    server.AddDocument(4, "lonely parrot"s, DocumentStatus::ACTUAL, {1});
+    server.RemoveDocument(4);
+    const std::string path = "index_snapshot_test.bin"s;
+    SaveIndexSnapshot(server, path);
+    {
+        const MappedSearchServer mapped_server(path);
+        ASSERT_EQUAL(mapped_server.GetDocumentCount(), server.GetDocumentCount());
+        ASSERT(std::equal(mapped_server.begin(), mapped_server.end(), server.begin(), server.end()));
+        for (const std::string& query : {"fluffy groomed cat"s, "cat -collar"s, "groomed in"s, "parrot"s}) {
+            const auto expected = server.FindTopDocuments(query);
+            const auto actual = mapped_server.FindTopDocuments(query);
+            ASSERT_EQUAL(expected.size(), actual.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(expected[i].id, actual[i].id);
+                ASSERT_EQUAL(expected[i].rating, actual[i].rating);
+                ASSERT(std::abs(expected[i].relevance - actual[i].relevance) < EPSILON);
+            }
+        }
+        ASSERT_EQUAL(mapped_server.FindTopDocuments("dog"s, DocumentStatus::BANNED).front().id, 3);
+        const auto [words, status] = mapped_server.MatchDocument("fluffy tail -collar in"s, 1);
+        ASSERT_EQUAL(static_cast<int>(words.size()), 2);
+        ASSERT(status == DocumentStatus::ACTUAL);
+        const auto expected_freqs = server.GetWordFrequencies(1);
+        const auto actual_freqs = mapped_server.GetWordFrequencies(1);
+        ASSERT_EQUAL(expected_freqs.size(), actual_freqs.size());
+        for (const auto& [word, freq] : expected_freqs) {
+            ASSERT(std::abs(actual_freqs.at(word) - freq) < EPSILON);
+        }
+    }
+    //Описание: снимок, сохранённый поверх открытого, не меняет уже отображённые данные
+    {
+        const MappedSearchServer mapped_server(path);
+        SearchServer updated_server("and in"s);
+        updated_server.AddDocument(6, "lonely cat"s, DocumentStatus::ACTUAL, {1});
+        SaveIndexSnapshot(updated_server, path);
+        ASSERT_EQUAL(mapped_server.GetDocumentCount(), server.GetDocumentCount());
+        ASSERT_EQUAL(mapped_server.FindTopDocuments("fluffy cat"s).front().id, 1);
+        ASSERT_EQUAL(MappedSearchServer(path).FindTopDocuments("cat"s).front().id, 6);
+        ASSERT(!std::ifstream(path + ".tmp"s));
+        SaveIndexSnapshot(server, path);
+    }
+    {
+        const MappedSearchServer mapped_server(path);
+        try {
+            mapped_server.FindTopDocuments("cat -x\x02y"s);
+            ASSERT_HINT(false, "Invalid query word must be rejected!"s);
+        } catch (const std::invalid_argument& e) {
+            ASSERT_EQUAL(std::string(e.what()), "Query word -x\x02y is invalid"s);
+        }
+    }
+    std::string snapshot;
+    {
+        std::ifstream file(path, std::ios::binary);
+        snapshot.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    // Без проверки контрольной суммы повреждённая структура всё равно должна отвергаться
+    const auto assert_rejected = [&path](const std::string& corrupted_snapshot) {
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(corrupted_snapshot.data(), corrupted_snapshot.size());
+        }
+        try {
+            MappedSearchServer corrupted_server(path, false);
+            ASSERT_HINT(false, "Corrupted snapshot must be rejected!"s);
+        } catch (const std::runtime_error&) {
+        }
+    };
+    SnapshotHeader header;
+    std::memcpy(&header, snapshot.data(), sizeof(header));
+    {
+        std::string corrupted_snapshot = snapshot;
+        SnapshotHeader corrupted_header = header;
+        corrupted_header.term_offsets.count = 0;
+        std::memcpy(corrupted_snapshot.data(), &corrupted_header, sizeof(corrupted_header));
+        assert_rejected(corrupted_snapshot);
+    }
+    // Без проверки контрольной суммы вхождения слова проверяются при первом обращении к нему
+    {
+        std::string corrupted_snapshot = snapshot;
+        const int ordinal = 1000;
+        std::memcpy(corrupted_snapshot.data() + header.postings.offset, &ordinal, sizeof(ordinal));
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(corrupted_snapshot.data(), corrupted_snapshot.size());
+        }
+        const MappedSearchServer corrupted_server(path, false);
+        ASSERT_EQUAL(static_cast<int>(corrupted_server.FindTopDocuments("starling"s).size()), 1);
+        try {
+            corrupted_server.FindTopDocuments("cat"s);
+            ASSERT_HINT(false, "Corrupted postings must be rejected!"s);
+        } catch (const std::runtime_error&) {
+        }
+    }
+    {
+        std::string corrupted_snapshot = snapshot;
+        const uint64_t offset = 1000;
+        std::memcpy(corrupted_snapshot.data() + header.posting_offsets.offset + sizeof(offset), &offset, sizeof(offset));
+        assert_rejected(corrupted_snapshot);
+    }
+    {
+        std::string corrupted_snapshot = snapshot;
+        corrupted_snapshot.back() = '\x7f';
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(corrupted_snapshot.data(), corrupted_snapshot.size());
+        }
+        try {
+            MappedSearchServer corrupted_server(path);
+            ASSERT_HINT(false, "Corrupted snapshot must be rejected!"s);
+        } catch (const std::runtime_error&) {
+        }
+    }
+    std::remove(path.c_str());
+}
+
+//Параллельный поиск. Результаты параллельной и последовательной версий должны совпадать.
+void TestParallelSearch() {
+    SearchServer server("and"s);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "white"s, "black"s, "fluffy"s, "tail"s, "eyes"s};
+    for (int document_id = 0; document_id < 3000; ++document_id) {
+        std::string text;
+        for (int i = 0; i < 6; ++i) {
+            text += words[(document_id * (i + 3) + i * i) % words.size()] + " "s;
+        }
+        server.AddDocument(document_id * 2, text, static_cast<DocumentStatus>(document_id % 3), {document_id % 17});
+    }
+    for (int document_id = 0; document_id < 6000; document_id += 14) {
+        server.RemoveDocument(document_id);
+    }
+    const auto is_even_rating = [](int document_id, DocumentStatus status, int rating) { return rating % 2 == 0; };
+    //Описание: результаты совпадают при любом способе распараллеливания и формате постингов
+    for (PostingsFormat format : {PostingsFormat::PLAIN, PostingsFormat::COMPRESSED}) {
+        server.SetPostingsFormat(format);
+        for (ParallelQueryMode mode : {ParallelQueryMode::AUTO, ParallelQueryMode::BY_WORDS, ParallelQueryMode::BY_DOCUMENT_RANGES}) {
+            server.SetParallelQueryMode(mode);
+            ASSERT(server.GetParallelQueryMode() == mode);
+            for (const std::string& query : {"cat"s, "white fluffy -dog"s, "bird eyes tail -black -cat"s, "-cat"s, "unknown"s}) {
+                const auto seq_docs = server.FindTopDocuments(std::execution::seq, query, is_even_rating, 20);
+                const auto par_docs = server.FindTopDocuments(std::execution::par, query, is_even_rating, 20);
+                ASSERT_EQUAL(seq_docs.size(), par_docs.size());
+                for (size_t i = 0; i < seq_docs.size(); ++i) {
+                    ASSERT_EQUAL(seq_docs[i].id, par_docs[i].id);
+                    ASSERT_EQUAL(seq_docs[i].relevance, par_docs[i].relevance);
+                }
+            }
+        }
+    }
+    //Описание: исключение из предиката посреди подсчёта не оставляет накопленную релевантность следующему запросу.
+    //Проверяется последовательный поиск: исключение из параллельного алгоритма завершает программу
+    const std::string query = "cat white fluffy"s;
+    const auto expected = server.FindTopDocuments(std::execution::seq, query, is_even_rating, 20);
+    ASSERT(!expected.empty());
+    int call_count = 0;
+    const auto throwing_predicate = [&call_count](int, DocumentStatus, int) {
+        if (++call_count > 50) {
+            throw std::runtime_error("predicate failed"s);
+        }
+        return true;
+    };
+    try {
+        server.FindTopDocuments(std::execution::seq, query, throwing_predicate, 20);
+        ASSERT_HINT(false, "Predicate exception must propagate"s);
+    } catch (const std::runtime_error&) {
+    }
+    const auto found = server.FindTopDocuments(std::execution::seq, query, is_even_rating, 20);
+    ASSERT_EQUAL(found.size(), expected.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL(found[i].id, expected[i].id);
+        ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+    }
+    //Описание: при релевантностях, отличающихся примерно на EPSILON, параллельный поиск в каждом
+    //режиме отбирает те же документы, что и последовательный, даже если они попали в разные диапазоны.
+    //Документ 1 ставится последним в первый диапазон параллельного поиска (ordinal_count / (4 * число потоков) + 1
+    //документов), документы 2 и 3 — первыми во второй
+    const int task_count = 4 * static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int range_size = 16 + 1;
+    SearchServer near_tie_server(""s);
+    AddNearTieDocuments(near_tie_server, range_size - 1, 16 * task_count - range_size - 2);
+    for (const ParallelQueryMode mode : {ParallelQueryMode::BY_WORDS, ParallelQueryMode::BY_DOCUMENT_RANGES}) {
+        near_tie_server.SetParallelQueryMode(mode);
+        for (const size_t max_result_count : {1u, 2u, 3u}) {
+            const auto sequential = near_tie_server.FindTopDocuments(std::execution::seq, "a b"s, DocumentStatus::ACTUAL, max_result_count);
+            const auto parallel = near_tie_server.FindTopDocuments(std::execution::par, "a b"s, DocumentStatus::ACTUAL, max_result_count);
+            ASSERT_EQUAL(parallel.size(), sequential.size());
+            for (size_t i = 0; i < parallel.size(); ++i) {
+                ASSERT_EQUAL(parallel[i].id, sequential[i].id);
+            }
+        }
+        ASSERT_EQUAL(near_tie_server.FindTopDocuments(std::execution::par, "a b"s, DocumentStatus::ACTUAL, 1).front().id, 3);
+    }
+}
+
+//Разбиение на слова. Все реализации совпадают с побайтовым разбиением и находят первый управляющий символ.
+void TestSplitIntoWords() {
+    const std::string alphabet = "ab \t\x01\x1f\x7f\x80\xff-"s;
+    std::vector<std::string_view> words;
+    for (int length = 0; length < 200; ++length) {
+        for (int seed = 0; seed < 8; ++seed) {
+            std::string text;
+            for (int i = 0; i < length; ++i) {
+                // Управляющие символы редки, чтобы в тексте встречались и допустимые длинные участки
+                const int index = (i * 7 + seed * 13 + i * i * seed) % 97;
+                text.push_back(index < 80 ? alphabet[index % 3] : alphabet[3 + index % (alphabet.size() - 3)]);
+            }
+            std::vector<std::string_view> expected_words;
+            size_t expected_control_pos = std::string_view::npos;
+            for (size_t pos = 0; pos < text.size();) {
+                if (text[pos] == ' ') {
+                    ++pos;
+                    continue;
+                }
+                const size_t end = std::min(text.find(' ', pos), text.size());
+                expected_words.push_back(std::string_view(text).substr(pos, end - pos));
+                pos = end;
+            }
+            for (size_t pos = 0; pos < text.size(); ++pos) {
+                if (static_cast<unsigned char>(text[pos]) < ' ') {
+                    expected_control_pos = pos;
+                    break;
+                }
+            }
+            for (SplitImplementation implementation : {SplitImplementation::AUTO, SplitImplementation::SCALAR,
+                                                       SplitImplementation::SSE2, SplitImplementation::AVX2}) {
+                if (!IsSplitImplementationSupported(implementation)) {
+                    continue;
+                }
+                ASSERT_EQUAL(SplitIntoWords(text, words, implementation), expected_control_pos);
+                ASSERT(words == expected_words);
+            }
+        }
+    }
+    {
+        SearchServer server(""s);
+        try {
+            server.AddDocument(1, std::string(70, 'a') + " bad\x02word tail"s, DocumentStatus::ACTUAL, {1});
+            ASSERT_HINT(false, "Document with control characters must be rejected"s);
+        } catch (const std::invalid_argument& error) {
+            ASSERT_EQUAL(std::string(error.what()), "Word bad\x02word is invalid"s);
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 0);
+    }
+}
+
+//Исключение документов. Документы с минус-словами не передаются в предикат, а поиск по статусу учитывает удаление документов.
+void TestExclusionBeforeScoring() {
+    SearchServer server(""s);
+    server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat bird"s, DocumentStatus::BANNED, {2});
+    server.AddDocument(3, "cat fish"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "cat"s, DocumentStatus::BANNED, {4});
+    for (ParallelQueryMode mode : {ParallelQueryMode::BY_WORDS, ParallelQueryMode::BY_DOCUMENT_RANGES}) {
+        server.SetParallelQueryMode(mode);
+        std::atomic<int> predicate_calls = 0;
+        const auto count_calls = [&predicate_calls](int document_id, DocumentStatus status, int rating) {
+            ++predicate_calls;
+            return document_id != 3;
+        };
+        ASSERT_EQUAL(server.FindTopDocuments("cat -dog -bird"s, count_calls).size(), 1u);
+        ASSERT_EQUAL(predicate_calls.load(), 2);
+        ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "cat -dog -bird"s, count_calls).size(), 1u);
+        ASSERT_EQUAL(predicate_calls.load(), 4);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).size(), 2u);
+    server.RemoveDocument(4);
+    server.AddDocument(5, "cat"s, DocumentStatus::ACTUAL, {5});
+    for (const auto& docs : {server.FindTopDocuments("cat -fish"s, DocumentStatus::BANNED),
+                             server.FindTopDocuments(std::execution::par, "cat -fish"s, DocumentStatus::BANNED)}) {
+        ASSERT_EQUAL(docs.size(), 1u);
+        ASSERT_EQUAL(docs[0].id, 2);
+    }
+    const auto actual_docs = server.FindTopDocuments("cat -fish"s);
+    ASSERT_EQUAL(actual_docs.size(), 2u);
+    ASSERT_EQUAL(actual_docs[0].id, 5);
+    ASSERT_EQUAL(actual_docs[1].id, 1);
+}
+
+//Отбор MaxScore. Результаты совпадают с полным перебором, включая равную релевантность с разным рейтингом, а часть вхождений пропускается.
+void TestMaxScorePruning() {
+    SearchServer server("and"s);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "white"s, "black"s, "fluffy"s, "tail"s, "eyes"s, "rare"s};
+    for (int document_id = 0; document_id < 4000; ++document_id) {
+        std::string text;
+        // Много одинаковых документов дают равную релевантность при разных рейтингах
+        const int text_seed = document_id % 500;
+        for (int i = 0; i < 2 + text_seed % 7; ++i) {
+            text += words[(text_seed * (i + 3) + i * i) % (text_seed % 50 == 0 ? words.size() : words.size() - 1)] + " "s;
+        }
+        server.AddDocument(document_id, text, static_cast<DocumentStatus>(document_id % 2), {document_id % 11});
+    }
+    for (int document_id = 0; document_id < 4000; document_id += 9) {
+        server.RemoveDocument(document_id);
+    }
+    const auto is_small_rating = [](int document_id, DocumentStatus status, int rating) { return rating < 8; };
+    const std::vector<std::string> queries = {"cat"s, "rare cat dog"s, "white fluffy -dog"s, "bird eyes tail rare -black"s,
+                                              "cat dog bird white black fluffy tail eyes rare"s, "unknown rare"s};
+    for (PostingsFormat format : {PostingsFormat::PLAIN, PostingsFormat::COMPRESSED}) {
+        server.SetPostingsFormat(format);
+        for (const std::string& query : queries) {
+            for (size_t max_count : {size_t{1}, size_t{5}, size_t{50}}) {
+                server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+                const auto expected = server.FindTopDocuments(query, is_small_rating, max_count);
+                const auto expected_status = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, max_count);
+                server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+                ASSERT(server.GetRetrievalMode() == RetrievalMode::MAX_SCORE);
+                const auto actual = server.FindTopDocuments(query, is_small_rating, max_count);
+                const auto actual_status = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, max_count);
+                for (const auto& [expected_docs, actual_docs] : {std::pair{expected, actual}, std::pair{expected_status, actual_status}}) {
+                    ASSERT_EQUAL(expected_docs.size(), actual_docs.size());
+                    for (size_t i = 0; i < expected_docs.size(); ++i) {
+                        ASSERT_EQUAL(expected_docs[i].id, actual_docs[i].id);
+                        ASSERT_EQUAL(expected_docs[i].relevance, actual_docs[i].relevance);
+                        ASSERT_EQUAL(expected_docs[i].rating, actual_docs[i].rating);
+                    }
+                }
+            }
+        }
+    }
+    server.ResetPruningStats();
+    server.FindTopDocuments("rare cat dog bird"s);
+    const PruningStats stats = server.GetPruningStats();
+    ASSERT(stats.total_postings > 0);
+    ASSERT_HINT(stats.scored_postings < stats.total_postings, "MaxScore should skip some postings"s);
+    server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+    // Документы с релевантностью, отличающейся меньше чем на EPSILON, отбираются так же, как при полном переборе
+    SearchServer near_tie_server(""s);
+    AddNearTieDocuments(near_tie_server);
+    for (const std::string& query : {"a b"s, "b a"s}) {
+        for (const size_t max_result_count : {1u, 2u, 3u}) {
+            near_tie_server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+            const auto expected = near_tie_server.FindTopDocuments(query, DocumentStatus::ACTUAL, max_result_count);
+            near_tie_server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+            const auto actual = near_tie_server.FindTopDocuments(query, DocumentStatus::ACTUAL, max_result_count);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL(actual[i].id, expected[i].id);
+                ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+            }
+        }
+        ASSERT_EQUAL(near_tie_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 1).front().id, 3);
+    }
+}
+
+//Кэш запросов. Равнозначные запросы попадают в кэш, изменение индекса делает записи устаревшими, запросы с предикатом кэш не используют.
+void TestRequestQueueCache() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL(server.NormalizeQuery("dog -cat and white  dog"s), "dog white -cat"s);
+    RequestQueue queue(server, 1 << 16);
+    ASSERT_EQUAL(queue.AddFindRequest("cat white"s).size(), 1u);
+    ASSERT_EQUAL(queue.AddFindRequest("white and cat cat"s).size(), 1u);
+    ASSERT_EQUAL(queue.AddFindRequest("white cat"s, DocumentStatus::BANNED).size(), 0u);
+    ASSERT_EQUAL(queue.GetCacheStats().hits, 1u);
+    ASSERT_EQUAL(queue.GetCacheStats().misses, 2u);
+    const uint64_t version = server.GetIndexVersion();
+    server.AddDocument(3, "cat"s, DocumentStatus::ACTUAL, {3});
+    ASSERT(server.GetIndexVersion() != version);
+    ASSERT_EQUAL(queue.AddFindRequest("cat white"s).size(), 2u);
+    ASSERT_EQUAL(queue.GetCacheStats().misses, 3u);
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(queue.AddFindRequest("cat white"s).size(), 1u);
+    ASSERT_EQUAL(queue.AddFindRequest("cat white"s).size(), 1u);
+    ASSERT_EQUAL(queue.GetCacheStats().hits, 2u);
+    queue.AddFindRequest("cat"s, [](int document_id, DocumentStatus status, int rating) { return true; });
+    ASSERT_EQUAL(queue.GetCacheStats().hits + queue.GetCacheStats().misses, 6u);
+    ASSERT_EQUAL(queue.GetNoResultRequests(), 1);
+    //Описание: записи вытесняются при превышении бюджета памяти
+    RequestQueue small_queue(server, 1);
+    small_queue.AddFindRequest("cat"s);
+    small_queue.AddFindRequest("cat"s);
+    ASSERT_EQUAL(small_queue.GetCacheStats().hits, 0u);
+    ASSERT_EQUAL(small_queue.GetCacheStats().used_bytes, 0u);
+}
+
+//Очередь запросов. Учитываются только последние сутки запросов, в том числе при записи из нескольких потоков.
+void TestConcurrentRequestQueue() {
+    SearchServer server(""s);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    {
+        RequestQueue queue(server, RequestQueueOptions{0, true});
+        for (int i = 0; i < 1439; ++i) {
+            queue.AddFindRequest("dog"s);
+        }
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 1439);
+        queue.AddFindRequest("cat"s);
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 1439);
+        queue.AddFindRequest("cat"s);
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 1438);
+        const auto requests = queue.GetRequests();
+        ASSERT_EQUAL(requests.size(), 1440u);
+        ASSERT_EQUAL(requests.front(), "cat"s);
+        ASSERT_EQUAL(requests.back(), "dog"s);
+    }
+    {
+        RequestQueue queue(server, 1 << 12);
+        ASSERT(queue.GetRequests().empty());
+        std::vector<std::thread> threads;
+        for (int thread_index = 0; thread_index < 4; ++thread_index) {
+            threads.emplace_back([&queue, thread_index] {
+                for (int i = 0; i < 1000; ++i) {
+                    queue.AddFindRequest(thread_index % 2 == 0 ? "dog"s : "cat"s);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const int no_result_requests = queue.GetNoResultRequests();
+        ASSERT(no_result_requests >= 0 && no_result_requests <= 1440);
+        for (int i = 0; i < 1440; ++i) {
+            queue.AddFindRequest("dog"s);
+        }
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 1440);
+        ASSERT_EQUAL(queue.GetCacheStats().hits + queue.GetCacheStats().misses, 5440u);
+    }
+}
+
+//Пакетная обработка. Результаты совпадают с ProcessQueries при любом числе потоков, ошибка запроса передаётся вызывающему.
+void TestBatchQueryExecutor() {
+    SearchServer server("and"s);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "white"s, "black"s, "fluffy"s, "tail"s, "eyes"s};
+    for (int document_id = 0; document_id < 500; ++document_id) {
+        std::string text;
+        for (int i = 0; i < 1 + document_id % 5; ++i) {
+            text += words[(document_id * (i + 3) + i * i) % words.size()] + " "s;
+        }
+        server.AddDocument(document_id, text, static_cast<DocumentStatus>(document_id % 3), {document_id % 7});
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < 200; ++i) {
+        queries.push_back(words[i % words.size()] + " "s + words[(i * 3) % words.size()] + (i % 4 == 0 ? " -"s + words[(i + 1) % words.size()] : ""s));
+    }
+    const auto expected = ProcessQueries(server, queries);
+    for (size_t thread_count : {1u, 3u}) {
+        BatchQueryExecutor executor(server, {thread_count, false});
+        ASSERT_EQUAL(executor.GetThreadCount(), thread_count);
+        for (int batch = 0; batch < 3; ++batch) {
+            const auto actual = executor.ProcessQueries(queries);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(actual[i].size(), expected[i].size());
+                for (size_t j = 0; j < expected[i].size(); ++j) {
+                    ASSERT_EQUAL(actual[i][j].id, expected[i][j].id);
+                    ASSERT_EQUAL(actual[i][j].relevance, expected[i][j].relevance);
+                }
+            }
+        }
+        try {
+            executor.ProcessQueries({"cat"s, "--dog"s, "bird"s});
+            ASSERT_HINT(false, "Invalid query must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+        ASSERT_EQUAL(executor.ProcessQueries({"cat"s}).size(), 1u);
+    }
+}
+
+//Результаты пакета. Сплошной буфер и представление по запросам согласованы с поиском по отдельным запросам.
+void TestBatchResults() {
+    SearchServer server(""s);
+    for (int document_id = 0; document_id < 20; ++document_id) {
+        server.AddDocument(document_id, (document_id % 2 == 0 ? "cat "s : "dog "s) + std::string(document_id + 1, 'x'),
+                           DocumentStatus::ACTUAL, {document_id});
+    }
+    const std::vector<std::string> queries = {"cat"s, "bird"s, "dog -xxx"s, "cat dog"s};
+    const BatchResults results = ProcessQueriesFlat(server, queries);
+    ASSERT_EQUAL(results.GetQueryCount(), queries.size());
+    std::vector<Document> joined;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = server.FindTopDocuments(queries[i]);
+        ASSERT_EQUAL(results[i].size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            ASSERT_EQUAL(results[i][j].id, expected[j].id);
+        }
+        joined.insert(joined.end(), expected.begin(), expected.end());
+    }
+    ASSERT(results[1].empty());
+    ASSERT_EQUAL(results.GetDocuments().size(), joined.size());
+    const auto joined_documents = ProcessQueriesJoined(server, queries);
+    ASSERT_EQUAL(joined_documents.size(), joined.size());
+    for (size_t i = 0; i < joined.size(); ++i) {
+        ASSERT_EQUAL(joined_documents[i].id, joined[i].id);
+        ASSERT_EQUAL(results.GetDocuments()[i].id, joined[i].id);
+    }
+    const auto nested = ProcessQueries(server, queries);
+    ASSERT_EQUAL(nested.size(), queries.size());
+    ASSERT_EQUAL(nested[3].size(), results[3].size());
+}
+
+//Асинхронный поиск. Результаты совпадают с синхронными, переполнение очереди и отмена завершают запрос исключением.
+void TestAsyncSearchServer() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black dog and cat"s, DocumentStatus::ACTUAL, {2});
+    AsyncSearchServer async_server(server, {1, 2});
+    auto documents = async_server.FindTopDocumentsAsync("cat -dog"s);
+    auto match = async_server.MatchDocumentAsync("dog cat"s, 2);
+    const auto found = documents.get();
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT_EQUAL(found[0].id, 1);
+    const auto [words, status] = match.get();
+    ASSERT(words == std::vector<std::string_view>({"cat", "dog"}));
+    ASSERT(status == DocumentStatus::ACTUAL);
+    try {
+        async_server.FindTopDocumentsAsync("--cat"s).get();
+        ASSERT_HINT(false, "Invalid query must fail"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    //Описание: пока единственный поток занят, в очередь помещаются только два запроса
+    std::promise<void> release;
+    std::promise<void> started;
+    async_server.FindTopDocumentsAsync("cat"s, DocumentStatus::ACTUAL, [&](std::vector<Document>, std::exception_ptr) {
+        started.set_value();
+        release.get_future().wait();
+    });
+    started.get_future().wait();
+    QueryCancellation cancellation;
+    auto cancelled = async_server.FindTopDocumentsAsync("cat"s, DocumentStatus::ACTUAL, &cancellation);
+    auto queued = async_server.FindTopDocumentsAsync("dog"s);
+    ASSERT_EQUAL(async_server.GetQueueDepth(), 2u);
+    bool is_rejected = false;
+    async_server.FindTopDocumentsAsync("cat"s, DocumentStatus::ACTUAL, [&](std::vector<Document>, std::exception_ptr error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const QueryRejectedError&) {
+            is_rejected = true;
+        }
+    });
+    ASSERT(is_rejected);
+    cancellation.Cancel();
+    release.set_value();
+    try {
+        cancelled.get();
+        ASSERT_HINT(false, "Cancelled query must fail"s);
+    } catch (const QueryCancelledError&) {
+    }
+    ASSERT_EQUAL(queued.get().size(), 1u);
+    const AsyncSearchStats stats = async_server.GetStats();
+    ASSERT_EQUAL(stats.rejected, 1u);
+    ASSERT_EQUAL(stats.cancelled, 1u);
+    ASSERT_EQUAL(stats.accepted, 6u);
+
+    //Описание: исключение из обработчика не завершает процесс, а учитывается в статистике
+    std::promise<void> find_called;
+    std::promise<void> match_called;
+    async_server.FindTopDocumentsAsync("cat"s, DocumentStatus::ACTUAL, [&](std::vector<Document>, std::exception_ptr) {
+        find_called.set_value();
+        throw std::runtime_error("callback failed"s);
+    });
+    async_server.MatchDocumentAsync("cat"s, 1, [&](AsyncSearchServer::MatchResult, std::exception_ptr) {
+        match_called.set_value();
+        throw std::runtime_error("callback failed"s);
+    });
+    find_called.get_future().wait();
+    match_called.get_future().wait();
+    ASSERT_EQUAL(async_server.FindTopDocumentsAsync("dog"s).get().size(), 1u);
+    const AsyncSearchStats callback_stats = async_server.GetStats();
+    ASSERT_EQUAL(callback_stats.callback_errors, 2u);
+    ASSERT_EQUAL(callback_stats.completed, callback_stats.accepted - callback_stats.cancelled);
+}
+
+//Удаление дубликатов. Из документов с одинаковым набором слов остаётся документ с наименьшим id.
+void TestRemoveDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    ASSERT_EQUAL(server.GetDocumentCount(), 9);
+    std::ostringstream report;
+    const std::vector<int> removed = RemoveDuplicates(server, &report);
+    ASSERT(removed == std::vector<int>({3, 4, 5, 7}));
+    ASSERT_EQUAL(report.str(), "Found duplicate document id 3\nFound duplicate document id 4\n"s
+                               "Found duplicate document id 5\nFound duplicate document id 7\n"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+    ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>({1, 2, 6, 8, 9}));
+    ASSERT_EQUAL(server.FindTopDocuments("curly"s).size(), 2u);
+    ASSERT(RemoveDuplicates(server, nullptr).empty());
+    try {
+        server.RemoveDocuments({1, 100});
+        ASSERT_HINT(false, "Unknown id must throw"s);
+    } catch (const std::out_of_range&) {
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+}
+
+//Поиск почти дубликатов. Похожие документы находятся и удаляются, оставляется документ с наименьшим id.
+void TestNearDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "white cat with long tail and green eyes near old house"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black dog barks at night in big yard"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "white cat with long tail and green eyes near new house"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "white cat with long tail and green eyes near old house"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(5, "black dog sleeps at day in small room"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(6, "white cat with long tail and green eyes near new house"s, DocumentStatus::ACTUAL, {1});
+    NearDuplicateOptions options;
+    options.similarity_threshold = 0.75;
+    options.band_count = 32;
+    options.rows_per_band = 2;
+    const std::vector<NearDuplicate> found = FindNearDuplicates(server, options);
+    ASSERT_EQUAL(found.size(), 3u);
+    for (const NearDuplicate& near_duplicate : found) {
+        ASSERT_EQUAL(near_duplicate.original_id, 1);
+        ASSERT(near_duplicate.similarity >= options.similarity_threshold);
+    }
+    ASSERT_EQUAL(found[0].document_id, 3);
+    ASSERT_EQUAL(found[1].document_id, 4);
+    ASSERT_EQUAL(found[1].similarity, 1.0);
+    ASSERT_EQUAL(found[2].document_id, 6);
+    ASSERT_EQUAL(server.GetDocumentCount(), 6);
+
+    options.similarity_threshold = 1.0;
+    ASSERT_EQUAL(FindNearDuplicates(server, options).size(), 2u);
+
+    options.similarity_threshold = 0.75;
+    std::ostringstream report;
+    ASSERT_EQUAL(RemoveNearDuplicates(server, options, &report).size(), 3u);
+    ASSERT(report.str().find("Found near duplicate document id 3 of 1"s) == 0);
+    ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>({1, 2, 5}));
+    ASSERT(RemoveNearDuplicates(server, options, nullptr).empty());
+
+    //Описание: в корзине больше документов, чем окно сравнения: часть дубликатов пропускается, и это отражается в статистике
+    SearchServer crowded_server(""s);
+    for (int document_id = 1; document_id <= 6; ++document_id) {
+        crowded_server.AddDocument(document_id, "same words in every document"s, DocumentStatus::ACTUAL, {1});
+    }
+    options.max_bucket_comparisons = 2;
+    NearDuplicateStats stats;
+    const std::vector<NearDuplicate> truncated = FindNearDuplicates(crowded_server, options, &stats);
+    ASSERT(truncated.size() < 5u);
+    ASSERT_EQUAL(stats.truncated_bucket_count, options.band_count);
+    std::ostringstream truncated_report;
+    RemoveNearDuplicates(crowded_server, options, &truncated_report);
+    ASSERT(truncated_report.str().find("Not all candidates compared in 32 oversized buckets"s) != std::string::npos);
+    options.max_bucket_comparisons = 5;
+    ASSERT_EQUAL(FindNearDuplicates(crowded_server, options, &stats).size(), 6u - truncated.size() - 1u);
+    ASSERT_EQUAL(stats.truncated_bucket_count, 0u);
+}
+
+//Удаление с отложенным уплотнением. Удалённые документы не должны находиться сразу, а результаты до и после уплотнения должны совпадать с индексом без них.
+void TestTombstoneCompaction() {
+    const std::vector<std::string> texts = {"white cat"s, "black cat long tail"s, "white dog"s, "parrot"s,
+                                            "cat and dog"s, "white parrot"s, "old dog"s, "lonely cat"s};
+    SearchServer server("and"s);
+    server.SetCompactionThreshold(1.0);
+    SearchServer expected_server("and"s);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        if (id % 2 == 0) {
+            expected_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+    }
+    server.RemoveDocuments({1, 3, 5});
+    server.RemoveDocument(7);
+    ASSERT_EQUAL(server.GetTombstoneCount(), 4);
+    ASSERT_EQUAL(server.GetDocumentCount(), 4);
+    const auto check = [&]() {
+        for (const std::string& query : {"cat"s, "white cat -dog"s, "parrot"s, "dog tail"s, "lonely"s}) {
+            const auto expected = expected_server.FindTopDocuments(query);
+            for (const auto& found : {server.FindTopDocuments(query), server.FindTopDocuments(std::execution::par, query),
+                                      server.FindTopDocuments(query, [](int, DocumentStatus, int) {
+                                          return true;
+                                      })}) {
+                ASSERT_EQUAL(found.size(), expected.size());
+                for (size_t i = 0; i < found.size(); ++i) {
+                    ASSERT_EQUAL(found[i].id, expected[i].id);
+                    ASSERT(std::abs(found[i].relevance - expected[i].relevance) < 1e-12);
+                }
+            }
+        }
+    };
+    check();
+    server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+    check();
+    const size_t memory_usage = server.GetPostingsMemoryUsage();
+    server.CompactPostings();
+    ASSERT_EQUAL(server.GetTombstoneCount(), 0);
+    ASSERT(server.GetPostingsMemoryUsage() < memory_usage);
+    check();
+    server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+    server.SetPostingsFormat(PostingsFormat::COMPRESSED);
+    check();
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), "black long tail parrot lonely"s.size() - 4);
+    server.CompactTextStore();
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), 0u);
+    server.AddDocument(9, "lonely dog"s, DocumentStatus::ACTUAL, {1});
+    expected_server.AddDocument(9, "lonely dog"s, DocumentStatus::ACTUAL, {1});
+    check();
+
+    server.SetCompactionThreshold(0.1);
+    server.RemoveDocument(0);
+    ASSERT_EQUAL(server.GetTombstoneCount(), 0);
+    expected_server.RemoveDocument(0);
+    check();
+}
+
+//Обновление документа. Смена статуса и рейтинга должна сразу учитываться в поиске, а новый текст должен давать те же результаты, что и заново добавленный документ.
+void TestUpdateDocument() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    const uint64_t version = server.GetIndexVersion();
+    server.UpdateDocumentStatus(2, DocumentStatus::BANNED);
+    ASSERT(server.GetIndexVersion() > version);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat"s, DocumentStatus::BANNED).front().id, 2);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "fluffy"s, DocumentStatus::BANNED).size(), 1u);
+    ASSERT(std::get<1>(server.MatchDocument("cat"s, 2)) == DocumentStatus::BANNED);
+    server.UpdateDocumentStatus(2, DocumentStatus::ACTUAL);
+    server.UpdateDocumentRating(1, {10, 20});
+    const auto found = server.FindTopDocuments("cat"s, [](int, DocumentStatus status, int rating) {
+        return status == DocumentStatus::ACTUAL && rating > 10;
+    });
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT_EQUAL(found.front().id, 1);
+    ASSERT_EQUAL(found.front().rating, 15);
+
+    server.UpdateDocument(2, "fluffy dog fluffy fluffy collar in garden"s);
+    server.UpdateDocument(3, "dog"s);
+    SearchServer expected_server("and in"s);
+    expected_server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {10, 20});
+    expected_server.AddDocument(2, "fluffy dog fluffy fluffy collar in garden"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    expected_server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    for (const PostingsFormat format : {PostingsFormat::PLAIN, PostingsFormat::COMPRESSED}) {
+        server.SetPostingsFormat(format);
+        for (const RetrievalMode mode : {RetrievalMode::EXHAUSTIVE, RetrievalMode::MAX_SCORE}) {
+            server.SetRetrievalMode(mode);
+            for (const std::string& query : {"fluffy"s, "cat tail"s, "dog collar -white"s, "eyes garden"s, "dog"s}) {
+                const auto expected = expected_server.FindTopDocuments(query);
+                const auto actual = server.FindTopDocuments(query);
+                ASSERT_EQUAL(actual.size(), expected.size());
+                for (size_t i = 0; i < actual.size(); ++i) {
+                    ASSERT_EQUAL(actual[i].id, expected[i].id);
+                    ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+                    ASSERT(std::abs(actual[i].relevance - expected[i].relevance) < 1e-12);
+                }
+            }
+        }
+    }
+    ASSERT(server.GetWordFrequencies(2) == expected_server.GetWordFrequencies(2));
+    ASSERT_EQUAL(server.GetReclaimableTextBytes(), "tail"s.size() + "groomed"s.size() + "expressive"s.size() + "eyes"s.size());
+
+    try {
+        server.UpdateDocument(3, "bad\x12word"s);
+        ASSERT_HINT(false, "Invalid text must throw"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 2u);
+    try {
+        server.UpdateDocumentStatus(100, DocumentStatus::BANNED);
+        ASSERT_HINT(false, "Unknown id must throw"s);
+    } catch (const std::out_of_range&) {
+    }
+}
+
+//Чтение во время изменений. Каждый запрос должен видеть целую версию индекса, а после изменений обе копии должны совпадать с обычным сервером.
+void TestConcurrentSearchServer() {
+    ConcurrentSearchServer server("and"s);
+    SearchServer expected_server("and"s);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "white"s, "black"s, "fluffy"s, "tail"s};
+    const auto make_text = [&words](int document_id) {
+        return "common "s + words[document_id % words.size()] + " "s + words[document_id * 3 % words.size()];
+    };
+    const int document_count = 300;
+    std::atomic<bool> is_writing{true};
+    std::atomic<int> snapshot_count{0};
+    std::vector<std::thread> readers;
+    for (int reader_index = 0; reader_index < 3; ++reader_index) {
+        readers.emplace_back([&] {
+            uint64_t last_version = 0;
+            while (is_writing) {
+                // Все документы содержат слово common, поэтому в целой версии их столько же, сколько найдено
+                const bool is_consistent = server.Read([&](const SearchServer& search_server) {
+                    const auto found = search_server.FindTopDocuments("common"s, [](int, DocumentStatus, int) {
+                        return true;
+                    }, document_count);
+                    const bool is_monotonic = search_server.GetIndexVersion() >= last_version;
+                    last_version = search_server.GetIndexVersion();
+                    return is_monotonic && static_cast<int>(found.size()) == search_server.GetDocumentCount();
+                });
+                ASSERT(is_consistent);
+                server.FindTopDocuments("fluffy cat -dog"s);
+                ++snapshot_count;
+            }
+        });
+    }
+    while (snapshot_count < 3) {
+        std::this_thread::yield();
+    }
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        server.AddDocument(document_id, make_text(document_id), DocumentStatus::ACTUAL, {document_id});
+        expected_server.AddDocument(document_id, make_text(document_id), DocumentStatus::ACTUAL, {document_id});
+        if (document_id % 10 == 9) {
+            server.RemoveDocuments({document_id - 9, document_id - 5});
+            expected_server.RemoveDocuments({document_id - 9, document_id - 5});
+            server.UpdateDocumentStatus(document_id - 1, DocumentStatus::BANNED);
+            expected_server.UpdateDocumentStatus(document_id - 1, DocumentStatus::BANNED);
+            server.UpdateDocument(document_id - 2, "common fluffy cat"s);
+            expected_server.UpdateDocument(document_id - 2, "common fluffy cat"s);
+        }
+    }
+    is_writing = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQUAL(server.GetStats().published_versions, static_cast<uint64_t>(document_count + document_count / 10 * 3));
+
+    try {
+        server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+        ASSERT_HINT(false, "Duplicate id must throw"s);
+    } catch (const std::invalid_argument&) {
+    }
+    // После каждого изменения активной становится другая копия: проверяются обе
+    for (int side = 0; side < 2; ++side) {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        ASSERT_EQUAL(server.GetIndexVersion(), expected_server.GetIndexVersion());
+        for (const std::string& query : {"fluffy cat"s, "dog -cat"s, "common"s, "bird tail"s}) {
+            const auto expected = expected_server.FindTopDocuments(query);
+            const auto actual = server.FindTopDocuments(query);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL(actual[i].id, expected[i].id);
+                ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+            }
+        }
+        const auto [matched_words, status] = server.MatchDocument("fluffy cat dog"s, 7);
+        ASSERT(matched_words == std::vector<std::string>({"cat"s, "fluffy"s}));
+        ASSERT(status == DocumentStatus::ACTUAL);
+        server.Modify([](SearchServer& search_server) {
+            search_server.SetPostingsFormat(PostingsFormat::COMPRESSED);
+        });
+    }
+}
+
+//Сегментированный индекс. Результаты должны совпадать с одним SearchServer при запечатывании, слияниях и удалениях, в том числе во время фонового слияния.
+void TestSegmentedSearchServer() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "white"s, "black"s, "fluffy"s, "tail"s, "eyes"s, "old"s};
+    const auto make_text = [&words](int document_id) {
+        std::string text;
+        for (int i = 0; i <= document_id % 4; ++i) {
+            text += words[(document_id * (i + 3) + i) % words.size()] + " and "s;
+        }
+        return text + words[document_id % words.size()];
+    };
+    const std::vector<std::string> queries = {"cat"s, "fluffy dog -white"s, "old eyes tail"s, "black bird"s, "cat dog bird white"s};
+    const auto check = [&queries](const SegmentedSearchServer& server, const SearchServer& expected_server) {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        for (const std::string& query : queries) {
+            for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto expected = expected_server.FindTopDocuments(query, status, 10);
+                const auto actual = server.FindTopDocuments(query, status, 10);
+                ASSERT_EQUAL(actual.size(), expected.size());
+                for (size_t i = 0; i < actual.size(); ++i) {
+                    ASSERT_EQUAL(actual[i].id, expected[i].id);
+                    ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+                    ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+                }
+            }
+        }
+    };
+    for (const bool background_merge : {false, true}) {
+        SegmentedIndexOptions options;
+        options.max_mutable_documents = 4;
+        options.merge_factor = 2;
+        options.background_merge = background_merge;
+        SegmentedSearchServer server("and"s, options);
+        SearchServer expected_server("and"s);
+        const int document_count = background_merge ? 400 : 60;
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            const DocumentStatus status = document_id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            server.AddDocument(document_id, make_text(document_id), status, {document_id % 5});
+            expected_server.AddDocument(document_id, make_text(document_id), status, {document_id % 5});
+            if (document_id % 5 == 4) {
+                server.RemoveDocument(document_id - 3);
+                expected_server.RemoveDocument(document_id - 3);
+            }
+            if (!background_merge && document_id % 6 == 5) {
+                check(server, expected_server);
+            }
+        }
+        server.WaitForMerges();
+        check(server, expected_server);
+        const SegmentedIndexStats stats = server.GetStats();
+        ASSERT_EQUAL(stats.seal_count, static_cast<uint64_t>(document_count / 4));
+        ASSERT(stats.merge_count > 0);
+        // При merge_factor = 2 сегментов не больше, чем единиц в двоичной записи числа запечатываний
+        ASSERT(stats.sealed_segment_count <= 7);
+        try {
+            server.AddDocument(0, "duplicate"s, DocumentStatus::ACTUAL, {});
+            ASSERT_HINT(false, "Duplicate id must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+        try {
+            server.RemoveDocument(1);
+            ASSERT_HINT(false, "Removed id must throw"s);
+        } catch (const std::out_of_range&) {
+        }
+        server.ForceMerge();
+        ASSERT_EQUAL(server.GetStats().sealed_segment_count, 1u);
+        ASSERT_EQUAL(server.GetStats().mutable_document_count, 0u);
+        check(server, expected_server);
+        const auto [matched_words, status] = server.MatchDocument("cat dog white"s, 2);
+        const auto [expected_words, expected_status] = expected_server.MatchDocument("cat dog white"s, 2);
+        ASSERT(matched_words == std::vector<std::string>(expected_words.begin(), expected_words.end()));
+        ASSERT(status == expected_status);
+    }
+    // Id, удалённый из сливающегося сегмента, добавляется заново и сразу должен находиться
+    SegmentedIndexOptions options;
+    options.max_mutable_documents = 16;
+    options.merge_factor = 2;
+    SegmentedSearchServer server("and"s, options);
+    SearchServer expected_server("and"s);
+    for (int document_id = 0; document_id < 1500; ++document_id) {
+        server.AddDocument(document_id, make_text(document_id), DocumentStatus::ACTUAL, {1});
+        expected_server.AddDocument(document_id, make_text(document_id), DocumentStatus::ACTUAL, {1});
+        if (document_id % 3 == 2) {
+            const int reborn_id = document_id / 2;
+            const std::string text = "reborn "s + make_text(document_id);
+            server.RemoveDocument(reborn_id);
+            server.AddDocument(reborn_id, text, DocumentStatus::ACTUAL, {2});
+            expected_server.RemoveDocument(reborn_id);
+            expected_server.AddDocument(reborn_id, text, DocumentStatus::ACTUAL, {2});
+            const auto found = server.FindTopDocuments("reborn"s, DocumentStatus::ACTUAL, 2000);
+            ASSERT(std::any_of(found.begin(), found.end(), [reborn_id](const Document& document) {
+                return document.id == reborn_id;
+            }));
+            const auto [matched_words, status] = server.MatchDocument("reborn"s, reborn_id);
+            ASSERT_EQUAL(matched_words.size(), 1u);
+        }
+    }
+    server.WaitForMerges();
+    check(server, expected_server);
+    const auto found = server.FindTopDocuments("reborn"s, DocumentStatus::ACTUAL, 2000);
+    ASSERT_EQUAL(found.size(), expected_server.FindTopDocuments("reborn"s, DocumentStatus::ACTUAL, 2000).size());
+    server.ForceMerge();
+    check(server, expected_server);
+}
+
+//Шардированный индекс. Результаты запросов, сопоставление и удаление должны совпадать с одним SearchServer при любом числе шардов.
+void TestShardedSearchServer() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "bird"s, "white"s, "black"s, "fluffy"s, "tail"s, "eyes"s, "old"s};
+    const auto make_text = [&words](int document_id) {
+        std::string text;
+        for (int i = 0; i <= document_id % 4; ++i) {
+            text += words[(document_id * (i + 3) + i) % words.size()] + " and "s;
+        }
+        return text + words[document_id % words.size()];
+    };
+    const std::vector<std::string> queries = {"cat"s, "fluffy dog -white"s, "old eyes tail"s, "black bird"s, "cat dog bird white"s};
+    const auto assert_equal_documents = [](const std::vector<Document>& actual, const std::vector<Document>& expected) {
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL(actual[i].id, expected[i].id);
+            ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+            ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+        }
+    };
+    const auto check = [&](const ShardedSearchServer& server, const SearchServer& expected_server) {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>(expected_server.begin(), expected_server.end()));
+        for (const std::string& query : queries) {
+            assert_equal_documents(server.FindTopDocuments(query), expected_server.FindTopDocuments(query));
+            assert_equal_documents(server.FindTopDocuments(std::execution::seq, query, DocumentStatus::BANNED, 7),
+                                   expected_server.FindTopDocuments(query, DocumentStatus::BANNED, 7));
+            const auto is_even = [](int document_id, DocumentStatus, int) {
+                return document_id % 2 == 0;
+            };
+            assert_equal_documents(server.FindTopDocuments(std::execution::par, query, is_even, 10),
+                                   expected_server.FindTopDocuments(query, is_even, 10));
+        }
+    };
+    for (const size_t shard_count : {1u, 3u, 8u}) {
+        ShardedSearchServer server("and"s, shard_count);
+        SearchServer expected_server("and"s);
+        ASSERT_EQUAL(server.GetShardCount(), shard_count);
+        std::vector<std::string> texts;
+        for (int document_id = 0; document_id < 200; ++document_id) {
+            texts.push_back(make_text(document_id));
+        }
+        texts[150] = "cat \x12" "dog"s;
+        std::vector<DocumentInput> documents;
+        for (int document_id = 0; document_id < 200; ++document_id) {
+            const DocumentStatus status = document_id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+            documents.push_back({document_id, texts[document_id], status, {document_id % 5}});
+        }
+        try {
+            server.AddDocuments(documents);
+            ASSERT_HINT(false, "Invalid document must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+        documents.resize(150);
+        expected_server.AddDocuments(documents);
+        check(server, expected_server);
+        try {
+            server.AddDocuments({{200, "cat"s, DocumentStatus::ACTUAL, {}}, {200, "dog"s, DocumentStatus::ACTUAL, {}}});
+            ASSERT_HINT(false, "Duplicate id in batch must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+        expected_server.AddDocument(200, "cat"s, DocumentStatus::ACTUAL, {});
+        for (int document_id = 150; document_id < 180; ++document_id) {
+            server.AddDocument(document_id, make_text(document_id), DocumentStatus::ACTUAL, {1, 2});
+            expected_server.AddDocument(document_id, make_text(document_id), DocumentStatus::ACTUAL, {1, 2});
+        }
+        check(server, expected_server);
+        std::vector<int> removed_ids;
+        for (int document_id = 3; document_id < 180; document_id += 4) {
+            removed_ids.push_back(document_id);
+        }
+        try {
+            server.RemoveDocuments({5, 1000});
+            ASSERT_HINT(false, "Missing id must throw"s);
+        } catch (const std::out_of_range&) {
+        }
+        server.RemoveDocuments(removed_ids);
+        expected_server.RemoveDocuments(removed_ids);
+        server.RemoveDocument(std::execution::par, 10);
+        expected_server.RemoveDocument(10);
+        check(server, expected_server);
+        const auto [matched_words, status] = server.MatchDocument(std::execution::par, "cat dog white -eyes"s, 2);
+        const auto [expected_words, expected_status] = expected_server.MatchDocument("cat dog white -eyes"s, 2);
+        ASSERT(matched_words == expected_words);
+        ASSERT(status == expected_status);
+        try {
+            server.MatchDocument("cat"s, 10);
+            ASSERT_HINT(false, "Removed id must throw"s);
+        } catch (const std::out_of_range&) {
+        }
+    }
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -170,4 +1521,28 @@ void TestSearchServer() {
     RUN_TEST(TestFiltering);
     RUN_TEST(TestStatus);
     RUN_TEST(TestComputeRelevance);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestDocumentTable);
+    RUN_TEST(TestCachedInverseDocumentFreq);
+    RUN_TEST(TestCompressedPostings);
+    RUN_TEST(TestMaxResultCount);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestCompactTextStore);
+    RUN_TEST(TestIndexSnapshot);
+    RUN_TEST(TestParallelSearch);
+    RUN_TEST(TestSplitIntoWords);
+    RUN_TEST(TestExclusionBeforeScoring);
+    RUN_TEST(TestMaxScorePruning);
+    RUN_TEST(TestRequestQueueCache);
+    RUN_TEST(TestConcurrentRequestQueue);
+    RUN_TEST(TestBatchQueryExecutor);
+    RUN_TEST(TestBatchResults);
+    RUN_TEST(TestAsyncSearchServer);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestTombstoneCompaction);
+    RUN_TEST(TestUpdateDocument);
+    RUN_TEST(TestConcurrentSearchServer);
+    RUN_TEST(TestSegmentedSearchServer);
+    RUN_TEST(TestShardedSearchServer);
 }
\ No newline at end of file
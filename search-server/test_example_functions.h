@@ -1,11 +1,28 @@
 #pragma once
 
 #include "search_server.h"
+#include "index_snapshot.h"
+#include "request_queue.h"
+#include "process_queries.h"
+#include "batch_query_executor.h"
+#include "async_search_server.h"
+#include "remove_duplicates.h"
+#include "near_duplicates.h"
+#include "concurrent_search_server.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
 
 #include <numeric>
 #include <cassert>
 #include <stdexcept>
 #include <string_view>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <atomic>
+#include <thread>
 
 using std::string_literals::operator""s;
 
@@ -62,4 +79,52 @@ void TestStatus();
 
 void TestComputeRelevance();
 
+void TestRemoveDocument();
+
+void TestDocumentTable();
+
+void TestCachedInverseDocumentFreq();
+
+void TestCompressedPostings();
+
+void TestMaxResultCount();
+
+void TestAddDocuments();
+
+void TestCompactTextStore();
+
+void TestIndexSnapshot();
+
+void TestParallelSearch();
+
+void TestSplitIntoWords();
+
+void TestExclusionBeforeScoring();
+
+void TestMaxScorePruning();
+
+void TestRequestQueueCache();
+
+void TestConcurrentRequestQueue();
+
+void TestBatchQueryExecutor();
+
+void TestBatchResults();
+
+void TestAsyncSearchServer();
+
+void TestRemoveDuplicates();
+
+void TestNearDuplicates();
+
+void TestTombstoneCompaction();
+
+void TestUpdateDocument();
+
+void TestConcurrentSearchServer();
+
+void TestSegmentedSearchServer();
+
+void TestShardedSearchServer();
+
 void TestSearchServer();
@@ -0,0 +1,36 @@
+#include "text_arena.h"
+
+#include <algorithm>
+
+std::string_view TextArena::Store(std::string_view text) {
+    // Пустой строке не нужна память; к тому же у нового хранилища ещё нет ни одного блока
+    if (text.empty()) {
+        return {};
+    }
+    if (text.size() > CHUNK_SIZE) {
+        large_chunks_.push_back(std::make_unique<char[]>(text.size()));
+        allocated_bytes_ += text.size();
+        stored_bytes_ += text.size();
+        char* data = large_chunks_.back().get();
+        std::copy(text.begin(), text.end(), data);
+        return {data, text.size()};
+    }
+    if (chunk_used_ + text.size() > CHUNK_SIZE) {
+        chunks_.push_back(std::make_unique<char[]>(CHUNK_SIZE));
+        allocated_bytes_ += CHUNK_SIZE;
+        chunk_used_ = 0;
+    }
+    char* data = chunks_.back().get() + chunk_used_;
+    std::copy(text.begin(), text.end(), data);
+    chunk_used_ += text.size();
+    stored_bytes_ += text.size();
+    return {data, text.size()};
+}
+
+size_t TextArena::GetStoredBytes() const {
+    return stored_bytes_;
+}
+
+size_t TextArena::GetAllocatedBytes() const {
+    return allocated_bytes_;
+}
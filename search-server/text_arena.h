@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Хранилище строк, выделяющее память крупными блоками. Сохранённые строки не перемещаются
+// до уничтожения хранилища, поэтому string_view на них остаются действительными
+class TextArena {
+public:
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    std::string_view Store(std::string_view text);
+
+    size_t GetStoredBytes() const;
+
+    size_t GetAllocatedBytes() const;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+
+    std::vector<std::unique_ptr<char[]>> large_chunks_;
+
+    size_t chunk_used_ = CHUNK_SIZE;
+
+    size_t stored_bytes_ = 0;
+
+    size_t allocated_bytes_ = 0;
+};
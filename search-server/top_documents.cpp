@@ -0,0 +1,71 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool IsBetterDocument(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocuments::TopDocuments(size_t max_count) : max_count_(max_count) {
+    heap_.reserve(max_count_);
+}
+
+void TopDocuments::Push(const Document& document) {
+    if (max_count_ == 0) {
+        return;
+    }
+    if (heap_.size() < max_count_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    } else if (IsBetterDocument(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    }
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+    for (const Document& document : other.heap_) {
+        Push(document);
+    }
+}
+
+size_t TopDocuments::GetMaxCount() const {
+    return max_count_;
+}
+
+double TopDocuments::GetMinCompetitiveRelevance() const {
+    if (max_count_ == 0 || heap_.size() < max_count_) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return heap_.front().relevance - EPSILON;
+}
+
+void TopDocuments::Reset(size_t max_count) {
+    max_count_ = max_count;
+    heap_.clear();
+    heap_.reserve(max_count_);
+}
+
+size_t TopDocuments::ExtractTo(Document* documents) {
+    std::sort_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    std::copy(heap_.begin(), heap_.end(), documents);
+    const size_t count = heap_.size();
+    heap_.clear();
+    return count;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsBetterDocument);
+    std::vector<Document> documents;
+    documents.swap(heap_);
+    return documents;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstddef>
+#include <vector>
+
+const double EPSILON = 1e-6;
+
+// Порядок выдачи: по убыванию релевантности, при равной (с точностью до EPSILON)
+// релевантности — по убыванию рейтинга, затем по возрастанию id
+bool IsBetterDocument(const Document& lhs, const Document& rhs);
+
+// Ограниченный отбор max_count лучших документов: куча, на вершине которой
+// хранится худший из отобранных
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t max_count);
+
+    void Push(const Document& document);
+
+    void Merge(const TopDocuments& other);
+
+    size_t GetMaxCount() const;
+
+    // Очищает отбор, сохраняя выделенную память
+    void Reset(size_t max_count);
+
+    // Документ с релевантностью ниже этого порога не может попасть в отбор
+    // независимо от рейтинга и id; пока отбор не заполнен, порог равен -inf
+    double GetMinCompetitiveRelevance() const;
+
+    std::vector<Document> Extract();
+
+    // Записывает отобранные документы в documents (не менее max_count мест),
+    // очищает отбор и возвращает число записанных документов
+    size_t ExtractTo(Document* documents);
+
+private:
+    size_t max_count_;
+
+    std::vector<Document> heap_;
+};